@@ -0,0 +1,25 @@
+#!/bin/sh
+# Linux build. Always builds the headless engine library and tools; pass "game"
+# to also build the raylib front end (needs raylib visible to pkg-config).
+set -e
+cd "$(dirname "$0")"
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-O2 -Wall"}
+
+mkdir -p build/obj
+for src in engine/*.c; do
+	$CC $CFLAGS -c "$src" -o "build/obj/$(basename "${src%.c}").o"
+done
+rm -f build/libengine.a
+ar rcs build/libengine.a build/obj/*.o
+
+$CC $CFLAGS tools/sim.c build/libengine.a -o build/2048-sim -lpthread -lm
+$CC $CFLAGS tools/bench.c build/libengine.a -o build/2048-bench -lpthread -lm
+$CC $CFLAGS tools/fuzz.c build/libengine.a -o build/2048-fuzz -lpthread -lm
+$CC $CFLAGS tools/replay.c build/libengine.a -o build/2048-replay -lpthread -lm
+$CC $CFLAGS tools/train.c build/libengine.a -o build/2048-train -lpthread -lm
+
+if [ "$1" = "game" ]; then
+	$CC $CFLAGS main.c build/libengine.a -o build/2048 $(pkg-config --cflags --libs raylib) -lm
+fi
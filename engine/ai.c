@@ -0,0 +1,304 @@
+#include "ai.h"
+#include "board_tables.h"
+#include "platform.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOST_PENALTY 200000.0f
+#define MONOTONICITY_POWER 4.0f
+#define MONOTONICITY_WEIGHT 47.0f
+#define SUM_POWER 3.5f
+#define SUM_WEIGHT 11.0f
+#define MERGES_WEIGHT 700.0f
+#define EMPTY_WEIGHT 270.0f
+
+static float heuristicTable[ROW_COUNT];
+static bool heuristicReady = false;
+
+// Rewards empty cells, adjacent equal tiles and monotonic rows, and penalises
+// large tiles that sit out of order.
+static float rowHeuristic(int row) {
+	int line[BWIDTH];
+	for (int j = 0; j < BWIDTH; ++j) {
+		line[j] = (row >> (4 * j)) & 0xF;
+	}
+
+	float sum = 0;
+	int empty = 0;
+	int merges = 0;
+	int prev = 0;
+	int counter = 0;
+	for (int j = 0; j < BWIDTH; ++j) {
+		int rank = line[j];
+		sum += powf(rank, SUM_POWER);
+		if (rank == 0) {
+			empty++;
+			continue;
+		}
+		if (prev == rank) {
+			counter++;
+		} else if (counter > 0) {
+			merges += 1 + counter;
+			counter = 0;
+		}
+		prev = rank;
+	}
+	if (counter > 0) merges += 1 + counter;
+
+	float monoLeft = 0;
+	float monoRight = 0;
+	for (int j = 1; j < BWIDTH; ++j) {
+		float a = powf(line[j - 1], MONOTONICITY_POWER);
+		float b = powf(line[j], MONOTONICITY_POWER);
+		if (line[j - 1] > line[j]) monoLeft += a - b;
+		else monoRight += b - a;
+	}
+
+	return LOST_PENALTY + EMPTY_WEIGHT * empty + MERGES_WEIGHT * merges
+		- MONOTONICITY_WEIGHT * fminf(monoLeft, monoRight) - SUM_WEIGHT * sum;
+}
+
+static void heuristicInit(void) {
+	if (heuristicReady) return;
+	for (int row = 0; row < ROW_COUNT; ++row) {
+		heuristicTable[row] = rowHeuristic(row);
+	}
+	heuristicReady = true;
+}
+
+static float rowsHeuristic(Board board) {
+	return heuristicTable[board & ROW_MASK]
+		+ heuristicTable[(board >> 16) & ROW_MASK]
+		+ heuristicTable[(board >> 32) & ROW_MASK]
+		+ heuristicTable[(board >> 48) & ROW_MASK];
+}
+
+float aiEvaluate(Board board) {
+	return rowsHeuristic(board) + rowsHeuristic(boardTranspose(board));
+}
+
+bool aiInit(Ai *ai) {
+	boardInit();
+	heuristicInit();
+	ai->table = calloc(AI_TABLE_SIZE, sizeof(AiEntry));
+	ai->depthLimit = 0;
+	ai->probCutoff = AI_PROB_CUTOFF;
+	ai->threads = 1;
+	ai->nodes = 0;
+	return ai->table != NULL;
+}
+
+void aiFree(Ai *ai) {
+	free(ai->table);
+	ai->table = NULL;
+}
+
+static AiEntry *tableSlot(Ai *ai, Board board) {
+	uint64_t hash = board * 0x9E3779B97F4A7C15ULL;
+	return &ai->table[hash >> (64 - AI_TABLE_BITS)];
+}
+
+static bool tableLookup(AiEntry *slot, Board board, int depth, float *value) {
+	int64_t data = atomicLoadRelaxed64(&slot->data);
+	int64_t check = atomicLoadRelaxed64(&slot->check);
+	if ((uint64_t)(check ^ data) != board) return false;
+	if ((int)(data >> 32) < depth) return false;
+
+	uint32_t bits = (uint32_t)data;
+	memcpy(value, &bits, sizeof(bits));
+	return true;
+}
+
+static void tableStore(AiEntry *slot, Board board, int depth, float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	int64_t data = ((int64_t)depth << 32) | bits;
+	atomicStoreRelaxed64(&slot->data, data);
+	atomicStoreRelaxed64(&slot->check, (int64_t)(board ^ (uint64_t)data));
+}
+
+static float maxNode(Ai *ai, Board board, int depth, float prob);
+
+static float chanceNode(Ai *ai, Board board, int depth, float prob) {
+	if (depth <= 0 || prob < ai->probCutoff) return aiEvaluate(board);
+
+	AiEntry *slot = tableSlot(ai, board);
+	float cached;
+	if (tableLookup(slot, board, depth, &cached)) return cached;
+
+	int empty = boardEmptyCount(board);
+	float cellProb = prob / empty;
+	float total = 0;
+	for (int cell = 0; cell < BWIDTH * BHEIGHT; ++cell) {
+		if ((board >> (4 * cell)) & 0xF) continue;
+		total += (1 - SPAWN_FOUR_PROB) * maxNode(ai, board | (1ULL << (4 * cell)), depth, cellProb * (1 - SPAWN_FOUR_PROB));
+		total += SPAWN_FOUR_PROB * maxNode(ai, board | (2ULL << (4 * cell)), depth, cellProb * SPAWN_FOUR_PROB);
+	}
+	float value = total / empty;
+
+	tableStore(slot, board, depth, value);
+	return value;
+}
+
+static float maxNode(Ai *ai, Board board, int depth, float prob) {
+	float best = 0;
+	ai->nodes++;
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		int score = 0;
+		Board moved = boardMove(board, dir, &score);
+		if (moved == board) continue;
+
+		float value = chanceNode(ai, moved, depth - 1, prob);
+		if (value > best) best = value;
+	}
+	return best;
+}
+
+static int depthForBoard(Board board) {
+	int empty = boardEmptyCount(board);
+	if (empty >= 8) return 2;
+	if (empty >= 4) return 3;
+	if (empty >= 2) return 4;
+	return 5;
+}
+
+// One spawn beneath one of the root's moves. weight is the spawn's probability.
+typedef struct AiTask {
+	Board board;
+	int move;
+	float weight;
+	float value;
+} AiTask;
+
+typedef struct AiJob {
+	AiTask tasks[DIR_COUNT * BWIDTH * BHEIGHT * 2];
+	int taskCount;
+	int depth;
+	volatile int64_t next;
+} AiJob;
+
+typedef struct AiWorker {
+	AiJob *job;
+	Ai local;
+} AiWorker;
+
+static void searchWorker(void *arg) {
+	AiWorker *worker = arg;
+	AiJob *job = worker->job;
+	for (;;) {
+		int64_t n = atomicAdd64(&job->next, 1);
+		if (n >= job->taskCount) break;
+
+		AiTask *task = &job->tasks[n];
+		task->value = maxNode(&worker->local, task->board, job->depth, task->weight);
+	}
+}
+
+static int bestMoveParallel(Ai *ai, Board board, int depth) {
+	AiJob job;
+	AiWorker workers[AI_MAX_THREADS];
+	bool legal[DIR_COUNT] = {false};
+
+	job.taskCount = 0;
+	job.depth = depth;
+	job.next = 0;
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		int score = 0;
+		Board moved = boardMove(board, dir, &score);
+		if (moved == board) continue;
+		legal[dir] = true;
+
+		int empty = boardEmptyCount(moved);
+		for (int cell = 0; cell < BWIDTH * BHEIGHT; ++cell) {
+			if ((moved >> (4 * cell)) & 0xF) continue;
+			job.tasks[job.taskCount++] = (AiTask){moved | (1ULL << (4 * cell)), dir, (1 - SPAWN_FOUR_PROB) / empty, 0};
+			job.tasks[job.taskCount++] = (AiTask){moved | (2ULL << (4 * cell)), dir, SPAWN_FOUR_PROB / empty, 0};
+		}
+	}
+
+	int count = ai->threads < AI_MAX_THREADS ? ai->threads : AI_MAX_THREADS;
+	for (int i = 0; i < count; ++i) {
+		workers[i].job = &job;
+		workers[i].local = *ai;
+		workers[i].local.nodes = 0;
+	}
+
+	runWorkers(count, searchWorker, workers, sizeof(AiWorker));
+	for (int i = 0; i < count; ++i) {
+		ai->nodes += workers[i].local.nodes;
+	}
+
+	float values[DIR_COUNT] = {0};
+	for (int n = 0; n < job.taskCount; ++n) {
+		values[job.tasks[n].move] += job.tasks[n].weight * job.tasks[n].value;
+	}
+
+	int best = -1;
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		if (legal[dir] && (best < 0 || values[dir] > values[best])) best = dir;
+	}
+	return best;
+}
+
+int aiBestMove(Ai *ai, Board board) {
+	int depth = ai->depthLimit > 0 ? ai->depthLimit : depthForBoard(board);
+	if (ai->threads > 1) return bestMoveParallel(ai, board, depth);
+
+	int best = -1;
+	float bestValue = -1;
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		int score = 0;
+		Board moved = boardMove(board, dir, &score);
+		if (moved == board) continue;
+
+		float value = chanceNode(ai, moved, depth, 1.0f);
+		if (value > bestValue) {
+			best = dir;
+			bestValue = value;
+		}
+	}
+	return best;
+}
+
+Direction policyExpectimax(Board board, Rng *rng, void *ctx) {
+	int dir = aiBestMove(ctx, board);
+	return dir < 0 ? MOVE_UP : dir;
+}
+
+// A worker's Ai, which policyExpectimax sees through its first member.
+typedef struct AiThread {
+	Ai ai;
+	bool ownsTable;
+} AiThread;
+
+void *aiThreadInit(void *ctx) {
+	AiThread *thread = malloc(sizeof(AiThread));
+	if (thread == NULL) return NULL;
+	if (!aiInit(&thread->ai)) {
+		free(thread);
+		return NULL;
+	}
+	thread->ownsTable = true;
+
+	const Ai *settings = ctx;
+	if (settings != NULL) {
+		thread->ai.depthLimit = settings->depthLimit;
+		thread->ai.probCutoff = settings->probCutoff;
+		thread->ai.threads = settings->threads;
+		if (settings->table != NULL) {
+			aiFree(&thread->ai);
+			thread->ai.table = settings->table;
+			thread->ownsTable = false;
+		}
+	}
+	return thread;
+}
+
+void aiThreadFree(void *threadCtx) {
+	AiThread *thread = threadCtx;
+	if (thread == NULL) return;
+	if (thread->ownsTable) aiFree(&thread->ai);
+	free(thread);
+}
@@ -0,0 +1,50 @@
+#ifndef AI_H
+#define AI_H
+
+#include "board.h"
+#include "rng.h"
+
+#define AI_TABLE_BITS 22
+#define AI_TABLE_SIZE (1 << AI_TABLE_BITS)
+// Chance branches whose probability falls below this are scored by the heuristic.
+#define AI_PROB_CUTOFF 0.0001f
+
+#define AI_MAX_THREADS 64
+
+// data packs the value's float bits (low half) and the depth (high half);
+// check holds board ^ data so that a slot torn by concurrent writers fails
+// to match on read instead of returning a wrong value.
+typedef struct AiEntry {
+	volatile int64_t check;
+	volatile int64_t data;
+} AiEntry;
+
+// Expectimax searcher. The transposition table is lossy (one entry per slot,
+// always replaced) and stays valid across searches, so an Ai should be kept
+// alive for a whole game or run. With threads > 1, aiBestMove splits the
+// root's chance nodes across that many threads which all share the table
+// without locks. An Ai must only be used by one caller at a time.
+typedef struct Ai {
+	AiEntry *table;
+	int depthLimit; // 0 picks the depth from the number of empty cells
+	float probCutoff;
+	int threads;
+	int64_t nodes;
+} Ai;
+
+bool aiInit(Ai *ai);
+void aiFree(Ai *ai);
+// Returns the move with the highest expected value, or -1 when no move is possible.
+int aiBestMove(Ai *ai, Board board);
+float aiEvaluate(Board board);
+
+// Policy adaptor for the simulator; ctx is the Ai owned by the calling thread.
+Direction policyExpectimax(Board board, Rng *rng, void *ctx);
+// Creates a worker's Ai, copying the search settings from ctx when it is an Ai.
+// Workers made from an Ai with a table all search through that table, which
+// is safe without locks and must outlive them; each keeps its own node count.
+// Otherwise every worker allocates a table of its own.
+void *aiThreadInit(void *ctx);
+void aiThreadFree(void *threadCtx);
+
+#endif
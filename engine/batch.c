@@ -0,0 +1,98 @@
+#include "board.h"
+#include "board_tables.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BATCH_X64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+static void moveBatchScalar(const Board *boards, Board *out, int *scores, int count, Direction dir) {
+	for (int n = 0; n < count; ++n) {
+		scores[n] = 0;
+		out[n] = boardMove(boards[n], dir, &scores[n]);
+	}
+}
+
+#ifdef BATCH_X64
+static bool hasAvx2(void) {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// boardTranspose on four boards at once.
+TARGET_AVX2 static __m256i transpose4(__m256i x) {
+	__m256i a1 = _mm256_and_si256(x, _mm256_set1_epi64x(0xF0F00F0FF0F00F0FULL));
+	__m256i a2 = _mm256_and_si256(x, _mm256_set1_epi64x(0x0000F0F00000F0F0ULL));
+	__m256i a3 = _mm256_and_si256(x, _mm256_set1_epi64x(0x0F0F00000F0F0000ULL));
+	__m256i a = _mm256_or_si256(a1, _mm256_or_si256(_mm256_slli_epi64(a2, 12), _mm256_srli_epi64(a3, 12)));
+	__m256i b1 = _mm256_and_si256(a, _mm256_set1_epi64x(0xFF00FF0000FF00FFULL));
+	__m256i b2 = _mm256_and_si256(a, _mm256_set1_epi64x(0x00FF00FF00000000ULL));
+	__m256i b3 = _mm256_and_si256(a, _mm256_set1_epi64x(0x00000000FF00FF00ULL));
+	return _mm256_or_si256(b1, _mm256_or_si256(_mm256_srli_epi64(b2, 24), _mm256_slli_epi64(b3, 24)));
+}
+
+// Each 64-bit lane holds one board. Every row is looked up with a gather into
+// the row tables, so four boards cost the same four lookups as one.
+TARGET_AVX2 static void moveBatchAvx2(const Board *boards, Board *out, int *scores, int count, Direction dir) {
+	bool vertical = dir == MOVE_UP || dir == MOVE_DOWN;
+	const uint16_t *table = (dir == MOVE_UP || dir == MOVE_LEFT) ? rowLeftTable : rowRightTable;
+	const __m256i rowMask = _mm256_set1_epi64x(ROW_MASK);
+	const __m256i scoreMask = _mm256_set1_epi64x(0xFFFFFFFF);
+
+	int n = 0;
+	for (; n + 4 <= count; n += 4) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(boards + n));
+		if (vertical) x = transpose4(x);
+
+		__m256i result = _mm256_setzero_si256();
+		__m256i score = _mm256_setzero_si256();
+		for (int i = 0; i < BHEIGHT; ++i) {
+			__m256i row = _mm256_and_si256(_mm256_srli_epi64(x, 16 * i), rowMask);
+			__m256i moved = _mm256_i64gather_epi64((const long long *)table, row, 2);
+			__m256i rowScore = _mm256_i64gather_epi64((const long long *)rowScoreTable, row, 4);
+			result = _mm256_or_si256(result, _mm256_slli_epi64(_mm256_and_si256(moved, rowMask), 16 * i));
+			score = _mm256_add_epi64(score, _mm256_and_si256(rowScore, scoreMask));
+		}
+
+		if (vertical) result = transpose4(result);
+		_mm256_storeu_si256((__m256i *)(out + n), result);
+
+		int64_t lanes[4];
+		_mm256_storeu_si256((__m256i *)lanes, score);
+		for (int k = 0; k < 4; ++k) {
+			scores[n + k] = (int)lanes[k];
+		}
+	}
+	moveBatchScalar(boards + n, out + n, scores + n, count - n, dir);
+}
+#endif
+
+void boardMoveBatch(const Board *boards, Board *out, int *scores, int count, Direction dir) {
+#ifdef BATCH_X64
+	static int avx2 = -1;
+	if (avx2 < 0) avx2 = hasAvx2();
+	if (avx2) {
+		moveBatchAvx2(boards, out, scores, count, dir);
+		return;
+	}
+#endif
+	moveBatchScalar(boards, out, scores, count, dir);
+}
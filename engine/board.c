@@ -0,0 +1,313 @@
+#include "board.h"
+#include "board_tables.h"
+#include <stddef.h>
+
+// Indexed by a packed 16-bit row. Merge scores do not depend on the side a row
+// is pushed towards, so one score table serves both directions.
+uint16_t rowLeftTable[ROW_COUNT + ROW_TABLE_PAD];
+uint16_t rowRightTable[ROW_COUNT + ROW_TABLE_PAD];
+uint32_t rowScoreTable[ROW_COUNT + ROW_TABLE_PAD];
+// selectTable[byte][k] is the position of the k-th set bit of byte.
+static uint8_t selectTable[256][8];
+static bool tablesReady = false;
+
+Board boardPack(int nums[BHEIGHT][BWIDTH]) {
+	Board board = 0;
+	for (int i = 0; i < BHEIGHT; ++i) {
+		for (int j = 0; j < BWIDTH; ++j) {
+			int exp = 0;
+			for (int num = nums[i][j]; num > 1; num >>= 1) exp++;
+			board = boardSetExp(board, i, j, exp);
+		}
+	}
+	return board;
+}
+
+void boardUnpack(Board board, int nums[BHEIGHT][BWIDTH]) {
+	for (int i = 0; i < BHEIGHT; ++i) {
+		for (int j = 0; j < BWIDTH; ++j) {
+			nums[i][j] = boardGetNum(board, i, j);
+		}
+	}
+}
+
+int boardGetExp(Board board, int i, int j) {
+	return (board >> (16 * i + 4 * j)) & 0xF;
+}
+
+int boardGetNum(Board board, int i, int j) {
+	int exp = boardGetExp(board, i, j);
+	return exp ? 1 << exp : 0;
+}
+
+Board boardSetExp(Board board, int i, int j, int exp) {
+	int shift = 16 * i + 4 * j;
+	return (board & ~(0xFULL << shift)) | ((Board)(exp & 0xF) << shift);
+}
+
+Board boardTranspose(Board board) {
+	Board a1 = board & 0xF0F00F0FF0F00F0FULL;
+	Board a2 = board & 0x0000F0F00000F0F0ULL;
+	Board a3 = board & 0x0F0F00000F0F0000ULL;
+	Board a = a1 | (a2 << 12) | (a3 >> 12);
+	Board b1 = a & 0xFF00FF0000FF00FFULL;
+	Board b2 = a & 0x00FF00FF00000000ULL;
+	Board b3 = a & 0x00000000FF00FF00ULL;
+	return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+Board boardMirror(Board board) {
+	board = ((board & 0x0F0F0F0F0F0F0F0FULL) << 4) | ((board >> 4) & 0x0F0F0F0F0F0F0F0FULL);
+	return ((board & 0x00FF00FF00FF00FFULL) << 8) | ((board >> 8) & 0x00FF00FF00FF00FFULL);
+}
+
+Board boardFlip(Board board) {
+	board = (board << 32) | (board >> 32);
+	return ((board & 0x0000FFFF0000FFFFULL) << 16) | ((board >> 16) & 0x0000FFFF0000FFFFULL);
+}
+
+Board boardApplySymmetry(Board board, int sym) {
+	if (sym & SYM_TRANSPOSE) board = boardTranspose(board);
+	if (sym & SYM_MIRROR) board = boardMirror(board);
+	if (sym & SYM_FLIP) board = boardFlip(board);
+	return board;
+}
+
+// Mirroring and flipping commute, but moving them before a transpose swaps
+// which axis each one reverses.
+int boardSymmetryInverse(int sym) {
+	if (!(sym & SYM_TRANSPOSE)) return sym;
+	return SYM_TRANSPOSE | ((sym & SYM_MIRROR) << 1) | ((sym & SYM_FLIP) >> 1);
+}
+
+// Directions pair up as UP/DOWN (0, 1) and LEFT/RIGHT (2, 3), so bit 1 picks
+// the axis and bit 0 the way along it.
+Direction boardSymmetryMove(int sym, Direction dir) {
+	int d = dir;
+	if (sym & SYM_TRANSPOSE) d ^= 2;
+	if ((sym & SYM_MIRROR) && (d & 2)) d ^= 1;
+	if ((sym & SYM_FLIP) && !(d & 2)) d ^= 1;
+	return (Direction)d;
+}
+
+void boardSymmetries(Board board, Board images[SYM_COUNT]) {
+	Board transposed = boardTranspose(board);
+	images[0] = board;
+	images[SYM_MIRROR] = boardMirror(board);
+	images[SYM_FLIP] = boardFlip(board);
+	images[SYM_MIRROR | SYM_FLIP] = boardFlip(images[SYM_MIRROR]);
+	images[SYM_TRANSPOSE] = transposed;
+	images[SYM_TRANSPOSE | SYM_MIRROR] = boardMirror(transposed);
+	images[SYM_TRANSPOSE | SYM_FLIP] = boardFlip(transposed);
+	images[SYM_TRANSPOSE | SYM_MIRROR | SYM_FLIP] = boardFlip(images[SYM_TRANSPOSE | SYM_MIRROR]);
+}
+
+Board boardCanonical(Board board, int *sym) {
+	Board images[SYM_COUNT];
+	boardSymmetries(board, images);
+
+	int best = 0;
+	for (int s = 1; s < SYM_COUNT; ++s) {
+		if (images[s] < images[best]) best = s;
+	}
+	if (sym != NULL) *sym = best;
+	return images[best];
+}
+
+static uint16_t rowReverse(uint16_t row) {
+	return (row >> 12) | ((row >> 4) & 0x00F0) | ((row << 4) & 0x0F00) | (row << 12);
+}
+
+// Slides a row towards nibble 0. Exponents cap at 0xF since a cell cannot hold more.
+static uint16_t rowMoveLeft(uint16_t row, int *score) {
+	int out[BWIDTH] = {0};
+	int count = 0;
+	bool canMerge = false;
+
+	for (int j = 0; j < BWIDTH; ++j) {
+		int exp = (row >> (4 * j)) & 0xF;
+		if (exp == 0) continue;
+
+		if (canMerge && out[count - 1] == exp && exp < 0xF) {
+			out[count - 1]++;
+			*score += (1 << exp) * SCORE_MULT;
+			canMerge = false;
+		} else {
+			out[count++] = exp;
+			canMerge = true;
+		}
+	}
+
+	uint16_t result = 0;
+	for (int j = 0; j < count; ++j) {
+		result |= out[j] << (4 * j);
+	}
+	return result;
+}
+
+void boardInit(void) {
+	if (tablesReady) return;
+
+	for (int row = 0; row < ROW_COUNT; ++row) {
+		int score = 0;
+		uint16_t left = rowMoveLeft(row, &score);
+		rowLeftTable[row] = left;
+		rowRightTable[rowReverse(row)] = rowReverse(left);
+		rowScoreTable[row] = score;
+	}
+
+	for (int byte = 0; byte < 256; ++byte) {
+		int k = 0;
+		for (int bit = 0; bit < 8; ++bit) {
+			if (byte & (1 << bit)) selectTable[byte][k++] = bit;
+		}
+	}
+	tablesReady = true;
+}
+
+static Board moveRowsLeft(Board board, int *score) {
+	Board result = 0;
+	for (int i = 0; i < BHEIGHT; ++i) {
+		uint16_t row = (board >> (16 * i)) & ROW_MASK;
+		result |= (Board)rowLeftTable[row] << (16 * i);
+		*score += rowScoreTable[row];
+	}
+	return result;
+}
+
+static Board moveRowsRight(Board board, int *score) {
+	Board result = 0;
+	for (int i = 0; i < BHEIGHT; ++i) {
+		uint16_t row = (board >> (16 * i)) & ROW_MASK;
+		result |= (Board)rowRightTable[row] << (16 * i);
+		*score += rowScoreTable[row];
+	}
+	return result;
+}
+
+Board boardMove(Board board, Direction dir, int *score) {
+	switch (dir) {
+		case MOVE_UP: return boardTranspose(moveRowsLeft(boardTranspose(board), score));
+		case MOVE_DOWN: return boardTranspose(moveRowsRight(boardTranspose(board), score));
+		case MOVE_LEFT: return moveRowsLeft(board, score);
+		case MOVE_RIGHT: return moveRowsRight(board, score);
+	}
+	return board;
+}
+
+#define NIBBLE_LOW_BITS 0x1111111111111111ULL
+// Cells that have a right-hand neighbour, and cells that have one below
+#define NOT_LAST_COLUMN 0x0111011101110111ULL
+#define NOT_LAST_ROW 0x0000111111111111ULL
+
+// Sets the low bit of every zero nibble of x.
+static Board zeroNibbles(Board x) {
+	x |= x >> 1;
+	x |= x >> 2;
+	return ~x & NIBBLE_LOW_BITS;
+}
+
+uint16_t boardEmptyMask(Board board) {
+	// Gather the low bit of every zero nibble into 16 contiguous bits
+	Board x = zeroNibbles(board);
+	x = (x | (x >> 3)) & 0x0303030303030303ULL;
+	x = (x | (x >> 6)) & 0x000F000F000F000FULL;
+	x = (x | (x >> 12)) & 0x000000FF000000FFULL;
+	return (uint16_t)(x | (x >> 24));
+}
+
+static int popcount16(uint16_t x) {
+	x = x - ((x >> 1) & 0x5555);
+	x = (x & 0x3333) + ((x >> 2) & 0x3333);
+	x = (x + (x >> 4)) & 0x0F0F;
+	return (x + (x >> 8)) & 0x1F;
+}
+
+int boardEmptyCount(Board board) {
+	return popcount16(boardEmptyMask(board));
+}
+
+int boardMaxExp(Board board) {
+	int max = 0;
+	for (int cell = 0; cell < BWIDTH * BHEIGHT; ++cell) {
+		int exp = (board >> (4 * cell)) & 0xF;
+		if (exp > max) max = exp;
+	}
+	return max;
+}
+
+Board boardSpawn(Board board, uint32_t random, int *cell, int *exp) {
+	uint16_t mask = boardEmptyMask(board);
+	int empty = popcount16(mask);
+	*cell = -1;
+	*exp = 0;
+	if (empty == 0) return board;
+
+	// Select the target-th empty cell from whichever byte of the mask holds it
+	int target = (random >> 1) % empty;
+	int lowCount = popcount16(mask & 0xFF);
+	int index = target < lowCount
+		? selectTable[mask & 0xFF][target]
+		: 8 + selectTable[mask >> 8][target - lowCount];
+
+	*cell = index;
+	*exp = spawnExp(random);
+	return board | ((Board)*exp << (4 * index));
+}
+
+// A move changes the board exactly when some tile has an empty cell ahead of
+// it or an equal neighbour along the move's axis.
+int boardLegalMoves(Board board) {
+	Board empty = zeroNibbles(board);
+	Board full = ~empty & NIBBLE_LOW_BITS;
+	// Tiles at the 0xF cap cannot merge any further
+	Board mergeable = full & ~zeroNibbles(~board);
+
+	Board pairsH = zeroNibbles(board ^ (board >> 4)) & mergeable & NOT_LAST_COLUMN;
+	Board pairsV = zeroNibbles(board ^ (board >> 16)) & mergeable & NOT_LAST_ROW;
+
+	Board left = (empty & (full >> 4) & NOT_LAST_COLUMN) | pairsH;
+	Board right = (full & (empty >> 4) & NOT_LAST_COLUMN) | pairsH;
+	Board up = (empty & (full >> 16) & NOT_LAST_ROW) | pairsV;
+	Board down = (full & (empty >> 16) & NOT_LAST_ROW) | pairsV;
+
+	return ((up != 0) << MOVE_UP) | ((down != 0) << MOVE_DOWN)
+		| ((left != 0) << MOVE_LEFT) | ((right != 0) << MOVE_RIGHT);
+}
+
+bool boardIsGameOver(Board board) {
+	return boardLegalMoves(board) == 0;
+}
+
+void boardMoveDeltas(Board board, Direction dir, int deltas[BHEIGHT][BWIDTH]) {
+	bool vertical = dir == MOVE_UP || dir == MOVE_DOWN;
+	bool reversed = dir == MOVE_DOWN || dir == MOVE_RIGHT;
+	int lineCount = vertical ? BWIDTH : BHEIGHT;
+	int lineLength = vertical ? BHEIGHT : BWIDTH;
+
+	for (int line = 0; line < lineCount; ++line) {
+		int lastExp = 0;
+		int target = -1;
+		bool canMerge = false;
+
+		// Walk the line starting from the wall the tiles slide towards
+		for (int k = 0; k < lineLength; ++k) {
+			int pos = reversed ? lineLength - 1 - k : k;
+			int i = vertical ? pos : line;
+			int j = vertical ? line : pos;
+			int exp = boardGetExp(board, i, j);
+
+			deltas[i][j] = 0;
+			if (exp == 0) continue;
+
+			if (canMerge && lastExp == exp && exp < 0xF) {
+				canMerge = false;
+			} else {
+				target++;
+				lastExp = exp;
+				canMerge = true;
+			}
+			deltas[i][j] = k - target;
+		}
+	}
+}
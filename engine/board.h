@@ -0,0 +1,83 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BWIDTH 4
+#define BHEIGHT 4
+
+#define SCORE_MULT 2
+
+// A 4x4 board packed into 64 bits. Each cell holds the log2 exponent of its
+// tile in 4 bits (0 = empty), row i occupies bits [16*i, 16*i + 16) and
+// column j is nibble j of its row. Other board sizes use the engines in sized.h.
+typedef uint64_t Board;
+
+typedef enum Direction {
+	MOVE_UP,
+	MOVE_DOWN,
+	MOVE_LEFT,
+	MOVE_RIGHT
+} Direction;
+
+#define DIR_COUNT 4
+
+// Builds the row move and score lookup tables. Must run before any move.
+void boardInit(void);
+
+Board boardPack(int nums[BHEIGHT][BWIDTH]);
+void boardUnpack(Board board, int nums[BHEIGHT][BWIDTH]);
+int boardGetExp(Board board, int i, int j);
+int boardGetNum(Board board, int i, int j);
+Board boardSetExp(Board board, int i, int j, int exp);
+Board boardTranspose(Board board);
+
+// The eight symmetries of the square. Symmetry s transposes when
+// SYM_TRANSPOSE is set, then reverses the columns (SYM_MIRROR) and the rows
+// (SYM_FLIP); 0 is the identity. Moves, merges and scores commute with all of
+// them once the direction is mapped through boardSymmetryMove.
+#define SYM_MIRROR 1
+#define SYM_FLIP 2
+#define SYM_TRANSPOSE 4
+#define SYM_COUNT 8
+
+Board boardMirror(Board board);
+Board boardFlip(Board board);
+Board boardApplySymmetry(Board board, int sym);
+// Returns the symmetry that undoes sym.
+int boardSymmetryInverse(int sym);
+// Returns the direction on boardApplySymmetry(board, sym) that matches dir on board.
+Direction boardSymmetryMove(int sym, Direction dir);
+// Writes boardApplySymmetry(board, s) to images[s] for every symmetry.
+void boardSymmetries(Board board, Board images[SYM_COUNT]);
+// Returns the smallest of the board's eight images, writing the symmetry that
+// produced it to *sym when sym is not NULL. A move picked on the canonical
+// board maps back with boardSymmetryMove(boardSymmetryInverse(*sym), dir).
+Board boardCanonical(Board board, int *sym);
+
+// Returns the board after shifting every tile in dir, adding merge points to *score.
+Board boardMove(Board board, Direction dir, int *score);
+// A spawned tile is a 4 with this probability and a 2 otherwise. Spawns on
+// every board size and the expectimax chance nodes all follow it.
+#define SPAWN_FOUR_PROB 0.5f
+
+// Places a 2 or 4 on an empty cell chosen from the bits of random. Writes the
+// cell index (i * BWIDTH + j) and exponent, or -1 and 0 when the board is full.
+Board boardSpawn(Board board, uint32_t random, int *cell, int *exp);
+// Bit k is set when cell k (i * BWIDTH + j) is empty.
+uint16_t boardEmptyMask(Board board);
+int boardEmptyCount(Board board);
+int boardMaxExp(Board board);
+// Bit (1 << dir) is set for every direction that would change the board.
+int boardLegalMoves(Board board);
+bool boardIsGameOver(Board board);
+
+// Moves count boards in the same direction, writing results to out and merge
+// points to scores. Uses AVX2 when the CPU supports it.
+void boardMoveBatch(const Board *boards, Board *out, int *scores, int count, Direction dir);
+
+// Fills deltas with how many cells each tile of board travels when moved in dir.
+void boardMoveDeltas(Board board, Direction dir, int deltas[BHEIGHT][BWIDTH]);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef BOARD_TABLES_H
+#define BOARD_TABLES_H
+
+#include "board.h"
+
+// Internal to the engine: the row lookup tables filled by boardInit.
+#define ROW_MASK 0xFFFFULL
+#define ROW_COUNT 65536
+// Spare entries so vector gathers can read a full 64-bit lane at the last row.
+#define ROW_TABLE_PAD 4
+
+extern uint16_t rowLeftTable[ROW_COUNT + ROW_TABLE_PAD];
+extern uint16_t rowRightTable[ROW_COUNT + ROW_TABLE_PAD];
+extern uint32_t rowScoreTable[ROW_COUNT + ROW_TABLE_PAD];
+
+// Random bits at or above this make a spawned tile a 2 rather than a 4.
+#define SPAWN_TWO_LIMIT ((uint64_t)((1.0 - SPAWN_FOUR_PROB) * 4294967296.0))
+
+// The exponent boardSpawn and the sized engines give a new tile. random
+// rotated right by one is compared with SPAWN_TWO_LIMIT, so bit 0 is the
+// deciding bit and at the default odds of one half it alone picks the 4, which
+// keeps every seed playing the same game. The cell comes from random >> 1,
+// which a single comparison leaves all but independent of this choice.
+static inline int spawnExp(uint32_t random) {
+	uint32_t fraction = (random >> 1) | (random << 31);
+	return fraction >= SPAWN_TWO_LIMIT ? 2 : 1;
+}
+
+#endif
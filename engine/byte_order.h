@@ -0,0 +1,22 @@
+#ifndef BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+#include <stdint.h>
+
+// Internal to the engine: little-endian fields of the file formats, read and
+// written a byte at a time so they do not depend on the host.
+static inline void putLE(uint8_t *out, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; ++i) {
+		out[i] = (uint8_t)(value >> (8 * i));
+	}
+}
+
+static inline uint64_t getLE(const uint8_t *in, int bytes) {
+	uint64_t value = 0;
+	for (int i = 0; i < bytes; ++i) {
+		value |= (uint64_t)in[i] << (8 * i);
+	}
+	return value;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#include "game.h"
+
+void gameReset(Game *game, uint64_t seed, uint64_t stream) {
+	boardInit();
+	game->board = 0;
+	game->score = 0;
+	game->moveCount = 0;
+	rngSeedStream(&game->rng, seed, stream);
+}
+
+bool gameMove(Game *game, Direction dir) {
+	Board moved = boardMove(game->board, dir, &game->score);
+	if (moved == game->board) return false;
+
+	game->board = moved;
+	game->moveCount++;
+	return true;
+}
+
+int gameSpawn(Game *game, int *cell) {
+	int exp;
+	game->board = boardSpawn(game->board, (uint32_t)rngNext(&game->rng), cell, &exp);
+	return exp ? 1 << exp : 0;
+}
+
+bool gameIsOver(const Game *game) {
+	return boardIsGameOver(game->board);
+}
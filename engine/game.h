@@ -0,0 +1,24 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "board.h"
+#include "rng.h"
+
+// The logical state of one game, independent of any rendering or input. All
+// tile spawns draw from the game's own generator, so a (seed, stream) pair
+// and the sequence of moves fully determine a game.
+typedef struct Game {
+	Board board;
+	int score;
+	int moveCount;
+	Rng rng;
+} Game;
+
+void gameReset(Game *game, uint64_t seed, uint64_t stream);
+// Applies a move and returns whether it changed the board. No tile is spawned.
+bool gameMove(Game *game, Direction dir);
+// Spawns a tile. Returns its value, or 0 if the board is full.
+int gameSpawn(Game *game, int *cell);
+bool gameIsOver(const Game *game);
+
+#endif
@@ -0,0 +1,313 @@
+#include "ntuple.h"
+#include "byte_order.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const NTuple ntupleShapes[NTUPLE_COUNT] = {
+	{4, {0, 1, 2, 3}},
+	{4, {4, 5, 6, 7}},
+	{6, {0, 1, 2, 4, 5, 6}},
+	{6, {4, 5, 6, 8, 9, 10}},
+};
+
+static size_t tupleSize(const NTuple *tuple) {
+	return (size_t)1 << (4 * tuple->cellCount);
+}
+
+// The tuple's exponents as one base-16 number, first cell lowest.
+static inline uint32_t tupleIndex(const NTuple *tuple, Board board) {
+	uint32_t index = 0;
+	for (int k = 0; k < tuple->cellCount; ++k) {
+		index |= (uint32_t)((board >> (4 * tuple->cells[k])) & 0xF) << (4 * k);
+	}
+	return index;
+}
+
+#define HEADER_FIXED_SIZE 8
+#define HEADER_TUPLE_SIZE 16
+
+// Weights go to and from files as raw floats, which only matches the format on
+// little-endian hosts.
+static bool hostLittleEndian(void) {
+	uint16_t one = 1;
+	uint8_t low;
+	memcpy(&low, &one, 1);
+	return low == 1;
+}
+
+static uint64_t alignUp(uint64_t offset) {
+	return (offset + NTUPLE_FILE_ALIGN - 1) / NTUPLE_FILE_ALIGN * NTUPLE_FILE_ALIGN;
+}
+
+// The offset of every table, laid out one after another past the header.
+static void tableOffsets(uint64_t offsets[NTUPLE_COUNT]) {
+	uint64_t offset = HEADER_FIXED_SIZE + HEADER_TUPLE_SIZE * NTUPLE_COUNT;
+	for (int t = 0; t < NTUPLE_COUNT; ++t) {
+		offsets[t] = alignUp(offset);
+		offset = offsets[t] + tupleSize(&ntupleShapes[t]) * sizeof(float);
+	}
+}
+
+// Checks the header of a mapped file against ntupleShapes and points tables
+// at the weights inside it.
+static bool parseFile(const MappedFile *file, const float *tables[NTUPLE_COUNT]) {
+	const uint8_t *data = file->data;
+	size_t headerSize = HEADER_FIXED_SIZE + HEADER_TUPLE_SIZE * NTUPLE_COUNT;
+	if (!hostLittleEndian() || file->size < headerSize
+		|| memcmp(data, NTUPLE_MAGIC, 4) != 0
+		|| getLE(data + 4, 2) != NTUPLE_VERSION
+		|| getLE(data + 6, 2) != NTUPLE_COUNT) {
+		return false;
+	}
+
+	for (int t = 0; t < NTUPLE_COUNT; ++t) {
+		const NTuple *tuple = &ntupleShapes[t];
+		const uint8_t *entry = data + HEADER_FIXED_SIZE + HEADER_TUPLE_SIZE * t;
+		if (entry[0] != tuple->cellCount) return false;
+		for (int k = 0; k < tuple->cellCount; ++k) {
+			if (entry[1 + k] != tuple->cells[k]) return false;
+		}
+
+		uint64_t offset = getLE(entry + 8, 8);
+		uint64_t bytes = tupleSize(tuple) * sizeof(float);
+		if (offset % sizeof(float) != 0 || offset > file->size || file->size - offset < bytes) return false;
+		tables[t] = (const float *)(data + offset);
+	}
+	return true;
+}
+
+bool ntupleInit(NTupleNet *net) {
+	bool ok = true;
+	net->file = (MappedFile){0};
+	for (int t = 0; t < NTUPLE_COUNT; ++t) {
+		net->weights[t] = calloc(tupleSize(&ntupleShapes[t]), sizeof(float));
+		ok &= net->weights[t] != NULL;
+	}
+	if (!ok) ntupleFree(net);
+	return ok;
+}
+
+void ntupleFree(NTupleNet *net) {
+	if (net->file.data != NULL) {
+		fileUnmap(&net->file);
+	} else {
+		for (int t = 0; t < NTUPLE_COUNT; ++t) free(net->weights[t]);
+	}
+	for (int t = 0; t < NTUPLE_COUNT; ++t) net->weights[t] = NULL;
+}
+
+// Writes a temporary file next to path and renames it into place, since
+// truncating a file that other processes have mapped makes their next read fault.
+bool ntupleSave(const NTupleNet *net, const char *path) {
+	if (!hostLittleEndian()) return false;
+	size_t pathLength = strlen(path);
+	char *tempPath = malloc(pathLength + sizeof(".tmp"));
+	if (tempPath == NULL) return false;
+	memcpy(tempPath, path, pathLength);
+	memcpy(tempPath + pathLength, ".tmp", sizeof(".tmp"));
+
+	FILE *file = fopen(tempPath, "wb");
+	if (file == NULL) {
+		free(tempPath);
+		return false;
+	}
+
+	uint64_t offsets[NTUPLE_COUNT];
+	tableOffsets(offsets);
+	uint8_t header[HEADER_FIXED_SIZE + HEADER_TUPLE_SIZE * NTUPLE_COUNT] = {0};
+	memcpy(header, NTUPLE_MAGIC, 4);
+	putLE(header + 4, NTUPLE_VERSION, 2);
+	putLE(header + 6, NTUPLE_COUNT, 2);
+	for (int t = 0; t < NTUPLE_COUNT; ++t) {
+		const NTuple *tuple = &ntupleShapes[t];
+		uint8_t *entry = header + HEADER_FIXED_SIZE + HEADER_TUPLE_SIZE * t;
+		entry[0] = (uint8_t)tuple->cellCount;
+		for (int k = 0; k < tuple->cellCount; ++k) entry[1 + k] = (uint8_t)tuple->cells[k];
+		putLE(entry + 8, offsets[t], 8);
+	}
+
+	static const uint8_t padding[NTUPLE_FILE_ALIGN] = {0};
+	bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+	uint64_t written = sizeof(header);
+	for (int t = 0; t < NTUPLE_COUNT && ok; ++t) {
+		size_t gap = (size_t)(offsets[t] - written);
+		size_t size = tupleSize(&ntupleShapes[t]);
+		ok = fwrite(padding, 1, gap, file) == gap && fwrite(net->weights[t], sizeof(float), size, file) == size;
+		written = offsets[t] + size * sizeof(float);
+	}
+
+	if (ok) {
+		ok = fileCommit(file, tempPath, path);
+	} else {
+		fclose(file);
+	}
+	if (!ok) remove(tempPath);
+	free(tempPath);
+	return ok;
+}
+
+bool ntupleLoad(NTupleNet *net, const char *path) {
+	MappedFile file;
+	if (!fileMapRead(&file, path)) return false;
+
+	const float *tables[NTUPLE_COUNT];
+	bool ok = parseFile(&file, tables);
+	for (int t = 0; t < NTUPLE_COUNT && ok; ++t) {
+		memcpy(net->weights[t], tables[t], tupleSize(&ntupleShapes[t]) * sizeof(float));
+	}
+	fileUnmap(&file);
+	return ok;
+}
+
+bool ntupleMap(NTupleNet *net, const char *path) {
+	const float *tables[NTUPLE_COUNT];
+	*net = (NTupleNet){{NULL}};
+	if (!fileMapRead(&net->file, path)) return false;
+	if (!parseFile(&net->file, tables)) {
+		fileUnmap(&net->file);
+		return false;
+	}
+
+	// Writing through these would fault, which is why mapped networks only play
+	for (int t = 0; t < NTUPLE_COUNT; ++t) net->weights[t] = (float *)tables[t];
+	return true;
+}
+
+float ntupleEvaluate(const NTupleNet *net, Board board) {
+	Board images[SYM_COUNT];
+	boardSymmetries(board, images);
+
+	float value = 0;
+	for (int t = 0; t < NTUPLE_COUNT; ++t) {
+		const float *weights = net->weights[t];
+		for (int s = 0; s < SYM_COUNT; ++s) {
+			value += weights[tupleIndex(&ntupleShapes[t], images[s])];
+		}
+	}
+	return value;
+}
+
+void ntupleUpdate(NTupleNet *net, Board board, float delta) {
+	Board images[SYM_COUNT];
+	boardSymmetries(board, images);
+
+	for (int t = 0; t < NTUPLE_COUNT; ++t) {
+		float *weights = net->weights[t];
+		for (int s = 0; s < SYM_COUNT; ++s) {
+			weights[tupleIndex(&ntupleShapes[t], images[s])] += delta;
+		}
+	}
+}
+
+// Writes the chosen afterstate, its merge points and its value alongside the move.
+static int bestAfterstate(const NTupleNet *net, Board board, Board *after, int *reward, float *afterValue) {
+	int best = -1;
+	float bestValue = 0;
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		int score = 0;
+		Board moved = boardMove(board, dir, &score);
+		if (moved == board) continue;
+
+		float value = ntupleEvaluate(net, moved);
+		if (best < 0 || score + value > bestValue) {
+			best = dir;
+			bestValue = score + value;
+			*after = moved;
+			*reward = score;
+			*afterValue = value;
+		}
+	}
+	return best;
+}
+
+int ntupleBestMove(const NTupleNet *net, Board board) {
+	Board after;
+	int reward;
+	float value;
+	return bestAfterstate(net, board, &after, &reward, &value);
+}
+
+void ntupleTrainGame(NTupleNet *net, Game *game, uint64_t seed, uint64_t stream, float alpha) {
+	int cell;
+	gameReset(game, seed, stream);
+	gameSpawn(game, &cell);
+	gameSpawn(game, &cell);
+
+	// The step is split between the NTUPLE_LOOKUPS weights that move together
+	float rate = alpha / NTUPLE_LOOKUPS;
+	Board prev = 0;
+	bool havePrev = false;
+	for (;;) {
+		Board after;
+		int reward;
+		float value;
+		int dir = bestAfterstate(net, game->board, &after, &reward, &value);
+		if (dir < 0) break;
+
+		if (havePrev) {
+			float error = reward + value - ntupleEvaluate(net, prev);
+			ntupleUpdate(net, prev, rate * error);
+		}
+		prev = after;
+		havePrev = true;
+
+		gameMove(game, dir);
+		gameSpawn(game, &cell);
+	}
+	if (havePrev) ntupleUpdate(net, prev, -rate * ntupleEvaluate(net, prev));
+}
+
+typedef struct TrainJob {
+	NTupleNet *net;
+	uint64_t seed;
+	int64_t first;
+	int64_t last;
+	float alpha;
+	volatile int64_t next;
+	NTupleTrainStats *stats;
+} TrainJob;
+
+static void trainWorker(void *arg) {
+	TrainJob *job = arg;
+	NTupleTrainStats local = {0};
+	for (;;) {
+		int64_t begin = job->first + atomicAdd64(&job->next, NTUPLE_CHUNK);
+		if (begin >= job->last) break;
+		int64_t end = begin + NTUPLE_CHUNK < job->last ? begin + NTUPLE_CHUNK : job->last;
+
+		for (int64_t n = begin; n < end; ++n) {
+			Game game;
+			ntupleTrainGame(job->net, &game, job->seed, n, job->alpha);
+			local.games++;
+			local.moves += game.moveCount;
+			local.totalScore += game.score;
+			if (game.score > local.bestScore) local.bestScore = game.score;
+			if (boardMaxExp(game.board) >= 11) local.reached2048++;
+		}
+	}
+
+	NTupleTrainStats *stats = job->stats;
+	atomicAdd64(&stats->games, local.games);
+	atomicAdd64(&stats->moves, local.moves);
+	atomicAdd64(&stats->totalScore, local.totalScore);
+	atomicMax64(&stats->bestScore, local.bestScore);
+	atomicAdd64(&stats->reached2048, local.reached2048);
+}
+
+void ntupleTrainParallel(NTupleNet *net, uint64_t seed, int64_t first, int64_t count, float alpha,
+	int threads, NTupleTrainStats *stats) {
+	TrainJob job = {net, seed, first, first + count, alpha, 0, stats};
+
+	int total = threads > 0 ? threads : cpuCount();
+	if (total > NTUPLE_MAX_THREADS) total = NTUPLE_MAX_THREADS;
+
+	boardInit();
+	// Every worker shares the job and claims games from its counter
+	runWorkers(total, trainWorker, &job, 0);
+}
+
+Direction policyNTuple(Board board, Rng *rng, void *ctx) {
+	int dir = ntupleBestMove(ctx, board);
+	return dir < 0 ? MOVE_UP : dir;
+}
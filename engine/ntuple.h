@@ -0,0 +1,95 @@
+#ifndef NTUPLE_H
+#define NTUPLE_H
+
+#include "game.h"
+#include "platform.h"
+#include "rng.h"
+
+// Value function over afterstates: a sum of lookup-table weights, one table
+// per tuple of cells, indexed by the exponents in those cells. Every tuple is
+// read on all eight symmetric images of the board, so the eight images share
+// weights and always get the same value.
+#define NTUPLE_COUNT 4
+#define NTUPLE_MAX_CELLS 6
+#define NTUPLE_LOOKUPS (NTUPLE_COUNT * SYM_COUNT)
+
+#define NTUPLE_ALPHA 0.1f
+
+// Network files are little-endian. A header holds the magic, a u16 version,
+// a u16 tuple count, then per tuple a u8 cell count, six u8 cells, a pad byte
+// and the u64 file offset of its table. Each table is its weights as raw
+// floats starting on an NTUPLE_FILE_ALIGN boundary, so a mapped file is used
+// in place with no parsing or copying.
+#define NTUPLE_MAGIC "2NTW"
+#define NTUPLE_VERSION 1
+#define NTUPLE_FILE_ALIGN 4096
+
+// Number of games handed out per unit of training work.
+#define NTUPLE_CHUNK 16
+#define NTUPLE_MAX_THREADS 256
+
+typedef struct NTuple {
+	int cellCount;
+	int cells[NTUPLE_MAX_CELLS]; // i * BWIDTH + j
+} NTuple;
+
+typedef struct NTupleNet {
+	float *weights[NTUPLE_COUNT]; // 16^cellCount entries each
+	MappedFile file; // backs the weights of a network from ntupleMap
+} NTupleNet;
+
+typedef struct NTupleTrainStats {
+	int64_t games;
+	int64_t moves;
+	int64_t totalScore;
+	int64_t bestScore;
+	int64_t reached2048; // games whose highest tile is 2048 or more
+} NTupleTrainStats;
+
+// The tuple shapes every network uses: two straight lines of four and two
+// 2x3 rectangles.
+extern const NTuple ntupleShapes[NTUPLE_COUNT];
+
+// Allocates a network with every weight at zero.
+bool ntupleInit(NTupleNet *net);
+// Frees or unmaps the weights, whichever way the network was made.
+void ntupleFree(NTupleNet *net);
+bool ntupleSave(const NTupleNet *net, const char *path);
+// Copies the weights of a network file into an initialised network, which
+// can then keep training.
+bool ntupleLoad(NTupleNet *net, const char *path);
+// Makes a network whose weights are the mapped file itself, ready to play in
+// no time however large the tables. The weights are read-only, so the network
+// must not be trained or updated. ntupleSave replaces files by renaming a new
+// one over them, so on POSIX a mapped network keeps its weights when
+// 2048-train writes a checkpoint to the same path. On Windows the save fails
+// instead while the file is mapped, and 2048-train reports the checkpoint as
+// not saved. Anything that rewrites the file in place makes the next
+// evaluation fault.
+bool ntupleMap(NTupleNet *net, const char *path);
+
+float ntupleEvaluate(const NTupleNet *net, Board board);
+// Adds delta to every weight that ntupleEvaluate reads for board.
+void ntupleUpdate(NTupleNet *net, Board board, float delta);
+// Returns the move maximising its merge points plus the value of the
+// afterstate, or -1 when no move is possible.
+int ntupleBestMove(const NTupleNet *net, Board board);
+
+// Plays one game greedily from an empty board, learning with TD(0) on
+// afterstates: each afterstate's value moves alpha of the way towards the next
+// move's merge points plus the next afterstate's value, and the last one
+// towards zero.
+void ntupleTrainGame(NTupleNet *net, Game *game, uint64_t seed, uint64_t stream, float alpha);
+// Trains on games [first, first + count) across threads workers (0 uses one
+// per CPU) and adds them to stats. Game n still draws from stream n, but the
+// workers update the shared weights without locks, Hogwild style: updates are
+// sparse, so they rarely touch the same weight, and a lost one only drops a
+// single small step. Runs are only reproducible with one thread.
+void ntupleTrainParallel(NTupleNet *net, uint64_t seed, int64_t first, int64_t count, float alpha,
+	int threads, NTupleTrainStats *stats);
+
+// Policy adaptor for the simulator; ctx is a loaded NTupleNet, which is only
+// read and so can be shared by every worker.
+Direction policyNTuple(Board board, Rng *rng, void *ctx);
+
+#endif
@@ -0,0 +1,158 @@
+#include "platform.h"
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+
+static DWORD WINAPI threadEntry(LPVOID arg) {
+	Thread *thread = arg;
+	thread->fn(thread->arg);
+	return 0;
+}
+
+bool threadStart(Thread *thread, ThreadFn fn, void *arg) {
+	thread->fn = fn;
+	thread->arg = arg;
+	thread->handle = CreateThread(NULL, 0, threadEntry, thread, 0, NULL);
+	return thread->handle != NULL;
+}
+
+void threadJoin(Thread *thread) {
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+}
+
+int cpuCount(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+}
+
+double timeNow(void) {
+	LARGE_INTEGER freq, counter;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / freq.QuadPart;
+}
+
+bool fileMapRead(MappedFile *map, const char *path) {
+	*map = (MappedFile){0};
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+	const void *data = NULL;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	if (mapping != NULL) data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		if (mapping != NULL) CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	map->data = data;
+	map->size = (size_t)size.QuadPart;
+	map->file = file;
+	map->mapping = mapping;
+	return true;
+}
+
+void fileUnmap(MappedFile *map) {
+	if (map->data == NULL) return;
+	UnmapViewOfFile(map->data);
+	CloseHandle(map->mapping);
+	CloseHandle(map->file);
+	*map = (MappedFile){0};
+}
+
+// Fails while to is mapped anywhere: a file with mapped views cannot be
+// deleted, which replacing it needs.
+bool fileCommit(FILE *file, const char *from, const char *to) {
+	bool ok = fflush(file) == 0 && _commit(_fileno(file)) == 0;
+	if (fclose(file) != 0) ok = false;
+	return ok && MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static void *threadEntry(void *arg) {
+	Thread *thread = arg;
+	thread->fn(thread->arg);
+	return NULL;
+}
+
+bool threadStart(Thread *thread, ThreadFn fn, void *arg) {
+	thread->fn = fn;
+	thread->arg = arg;
+	return pthread_create(&thread->handle, NULL, threadEntry, thread) == 0;
+}
+
+void threadJoin(Thread *thread) {
+	pthread_join(thread->handle, NULL);
+}
+
+int cpuCount(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+}
+
+double timeNow(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+bool fileMapRead(MappedFile *map, const char *path) {
+	*map = (MappedFile){0};
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	// The mapping keeps the file alive on its own once the descriptor closes
+	struct stat info;
+	void *data = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && info.st_size > 0) {
+		data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (data == MAP_FAILED) return false;
+
+	map->data = data;
+	map->size = (size_t)info.st_size;
+	return true;
+}
+
+void fileUnmap(MappedFile *map) {
+	if (map->data == NULL) return;
+	munmap((void *)map->data, map->size);
+	*map = (MappedFile){0};
+}
+
+bool fileCommit(FILE *file, const char *from, const char *to) {
+	bool ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+	if (fclose(file) != 0) ok = false;
+	return ok && rename(from, to) == 0;
+}
+#endif
+
+void runWorkers(int count, ThreadFn fn, void *args, size_t stride) {
+	Thread *threads = count > 1 ? malloc(count * sizeof(Thread)) : NULL;
+	int started = 1;
+	while (threads != NULL && started < count
+		&& threadStart(&threads[started], fn, (char *)args + started * stride)) {
+		started++;
+	}
+	fn(args);
+	for (int i = 1; i < started; ++i) {
+		threadJoin(&threads[i]);
+	}
+	free(threads);
+}
@@ -0,0 +1,117 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+typedef void (*ThreadFn)(void *arg);
+
+typedef struct Thread {
+	ThreadFn fn;
+	void *arg;
+#ifdef _WIN32
+	void *handle;
+#else
+	pthread_t handle;
+#endif
+} Thread;
+
+// A whole file mapped read-only. Pages load on first touch and come from the
+// page cache, so every process mapping the same file shares one copy.
+typedef struct MappedFile {
+	const void *data;
+	size_t size;
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#endif
+} MappedFile;
+
+bool threadStart(Thread *thread, ThreadFn fn, void *arg);
+void threadJoin(Thread *thread);
+// Runs fn for count workers and returns once all are done. Worker i gets
+// (char *)args + i * stride, so a stride of 0 hands every worker the same
+// argument. The calling thread works as worker 0. Workers whose thread fails
+// to start never run, so fn must let the others pick up their share.
+void runWorkers(int count, ThreadFn fn, void *args, size_t stride);
+int cpuCount(void);
+// Monotonic wall clock in seconds.
+double timeNow(void);
+// Fails on empty files, which cannot be mapped.
+bool fileMapRead(MappedFile *map, const char *path);
+void fileUnmap(MappedFile *map);
+// Flushes file to disk, closes it and renames the file at from over to. On
+// POSIX anything that mapped the old file at to keeps the old contents, since
+// the rename swaps in a new file instead of rewriting the mapped one. Windows
+// will not replace a file while any process has it mapped, so there the
+// rename fails and from is left in place.
+bool fileCommit(FILE *file, const char *from, const char *to);
+
+#ifdef _WIN32
+#include <intrin.h>
+
+static inline int64_t atomicLoad64(volatile int64_t *ptr) {
+	return _InterlockedCompareExchange64((volatile long long *)ptr, 0, 0);
+}
+
+static inline void atomicStore64(volatile int64_t *ptr, int64_t value) {
+	_InterlockedExchange64((volatile long long *)ptr, value);
+}
+
+// Returns the value held before the addition.
+static inline int64_t atomicAdd64(volatile int64_t *ptr, int64_t value) {
+	return _InterlockedExchangeAdd64((volatile long long *)ptr, value);
+}
+
+static inline bool atomicCas64(volatile int64_t *ptr, int64_t expected, int64_t desired) {
+	return _InterlockedCompareExchange64((volatile long long *)ptr, desired, expected) == expected;
+}
+
+// Aligned 64-bit volatile accesses are single instructions on x64.
+static inline int64_t atomicLoadRelaxed64(volatile int64_t *ptr) {
+	return *ptr;
+}
+
+static inline void atomicStoreRelaxed64(volatile int64_t *ptr, int64_t value) {
+	*ptr = value;
+}
+#else
+static inline int64_t atomicLoad64(volatile int64_t *ptr) {
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomicStore64(volatile int64_t *ptr, int64_t value) {
+	__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static inline int64_t atomicAdd64(volatile int64_t *ptr, int64_t value) {
+	return __atomic_fetch_add(ptr, value, __ATOMIC_ACQ_REL);
+}
+
+static inline bool atomicCas64(volatile int64_t *ptr, int64_t expected, int64_t desired) {
+	return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline int64_t atomicLoadRelaxed64(volatile int64_t *ptr) {
+	return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+static inline void atomicStoreRelaxed64(volatile int64_t *ptr, int64_t value) {
+	__atomic_store_n(ptr, value, __ATOMIC_RELAXED);
+}
+#endif
+
+static inline void atomicMax64(volatile int64_t *ptr, int64_t value) {
+	int64_t current = atomicLoad64(ptr);
+	while (current < value && !atomicCas64(ptr, current, value)) {
+		current = atomicLoad64(ptr);
+	}
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include "profile.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+bool profileInit(Profiler *profiler) {
+	profiler->events = calloc(PROFILE_EVENTS, sizeof(ProfileEvent));
+	profiler->frames = calloc(PROFILE_FRAMES, sizeof(ProfileFrame));
+	profiler->eventCount = 0;
+	profiler->frameCount = 0;
+	profiler->origin = timeNow();
+	profiler->frameStart = 0;
+	profiler->drawCalls = 0;
+	if (profiler->events == NULL || profiler->frames == NULL) {
+		profileFree(profiler);
+		return false;
+	}
+	return true;
+}
+
+void profileFree(Profiler *profiler) {
+	free(profiler->events);
+	free(profiler->frames);
+	profiler->events = NULL;
+	profiler->frames = NULL;
+}
+
+void profileFrameBegin(Profiler *profiler) {
+	profiler->frameStart = timeNow() - profiler->origin;
+	profiler->drawCalls = 0;
+}
+
+void profileFrameEnd(Profiler *profiler) {
+	if (profiler->frames == NULL) return;
+	ProfileFrame *frame = &profiler->frames[profiler->frameCount % PROFILE_FRAMES];
+	frame->start = profiler->frameStart;
+	frame->duration = timeNow() - profiler->origin - profiler->frameStart;
+	frame->drawCalls = profiler->drawCalls;
+	++profiler->frameCount;
+}
+
+int64_t profileBegin(Profiler *profiler, const char *name) {
+	if (profiler->events == NULL) return 0;
+	int64_t id = profiler->eventCount++;
+	ProfileEvent *event = &profiler->events[id % PROFILE_EVENTS];
+	event->name = name;
+	event->start = timeNow() - profiler->origin;
+	event->duration = 0;
+	event->frame = profiler->frameCount;
+	return id;
+}
+
+void profileEnd(Profiler *profiler, int64_t id) {
+	// The ring may have wrapped past a long-running scope
+	if (profiler->events == NULL || profiler->eventCount - id > PROFILE_EVENTS) return;
+	ProfileEvent *event = &profiler->events[id % PROFILE_EVENTS];
+	event->duration = timeNow() - profiler->origin - event->start;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+void profileSummarize(const Profiler *profiler, ProfileSummary *summary) {
+	int count = profiler->frames == NULL ? 0
+		: profiler->frameCount < PROFILE_FRAMES ? (int)profiler->frameCount : PROFILE_FRAMES;
+	double sorted[PROFILE_FRAMES];
+	double total = 0;
+	int64_t draws = 0;
+	for (int i = 0; i < count; ++i) {
+		sorted[i] = profiler->frames[i].duration;
+		total += sorted[i];
+		draws += profiler->frames[i].drawCalls;
+	}
+	qsort(sorted, count, sizeof(double), compareDoubles);
+
+	summary->frames = count;
+	if (count == 0) {
+		summary->min = summary->avg = summary->p99 = summary->drawCalls = 0;
+		return;
+	}
+	summary->min = sorted[0];
+	summary->avg = total / count;
+	summary->p99 = sorted[(count * 99) / 100];
+	summary->drawCalls = (double)draws / count;
+}
+
+bool profileWriteTrace(const Profiler *profiler, const char *path) {
+	FILE *file = fopen(path, "w");
+	if (file == NULL) return false;
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+
+	int64_t firstFrame = profiler->frameCount > PROFILE_FRAMES ? profiler->frameCount - PROFILE_FRAMES : 0;
+	for (int64_t n = firstFrame; n < profiler->frameCount; ++n) {
+		const ProfileFrame *frame = &profiler->frames[n % PROFILE_FRAMES];
+		fprintf(file, "%s{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+			"\"args\":{\"frame\":%lld,\"drawCalls\":%d}}",
+			first ? "" : ",\n", frame->start * 1e6, frame->duration * 1e6, (long long)n, frame->drawCalls);
+		first = false;
+	}
+
+	int64_t firstEvent = profiler->eventCount > PROFILE_EVENTS ? profiler->eventCount - PROFILE_EVENTS : 0;
+	for (int64_t n = firstEvent; n < profiler->eventCount; ++n) {
+		const ProfileEvent *event = &profiler->events[n % PROFILE_EVENTS];
+		fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+			"\"args\":{\"frame\":%lld}}",
+			first ? "" : ",\n", event->name, event->start * 1e6, event->duration * 1e6, (long long)event->frame);
+		first = false;
+	}
+
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
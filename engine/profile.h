@@ -0,0 +1,63 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Both buffers are rings: once full, the oldest entries are overwritten.
+#define PROFILE_FRAMES 512
+#define PROFILE_EVENTS 16384
+
+typedef struct ProfileEvent {
+	const char *name; // must outlive the profiler, normally a string literal
+	double start;     // seconds since profileInit
+	double duration;
+	int64_t frame;
+} ProfileEvent;
+
+typedef struct ProfileFrame {
+	double start;
+	double duration;
+	int drawCalls;
+} ProfileFrame;
+
+typedef struct ProfileSummary {
+	int frames;
+	double min;
+	double avg;
+	double p99;
+	double drawCalls; // average per frame
+} ProfileSummary;
+
+// Records named timing scopes and per-frame totals for a single thread.
+// eventCount and frameCount only grow; entry n lives at n % the ring size.
+// If profileInit fails, every call is a no-op.
+typedef struct Profiler {
+	ProfileEvent *events;
+	ProfileFrame *frames;
+	int64_t eventCount;
+	int64_t frameCount;
+	double origin;
+	double frameStart;
+	int drawCalls;
+} Profiler;
+
+bool profileInit(Profiler *profiler);
+void profileFree(Profiler *profiler);
+
+void profileFrameBegin(Profiler *profiler);
+void profileFrameEnd(Profiler *profiler);
+// Opens a scope and returns its id for profileEnd. Scopes may nest.
+int64_t profileBegin(Profiler *profiler, const char *name);
+void profileEnd(Profiler *profiler, int64_t id);
+static inline void profileDraws(Profiler *profiler, int count) {
+	profiler->drawCalls += count;
+}
+
+// Frame time statistics over the frames still held in the ring.
+void profileSummarize(const Profiler *profiler, ProfileSummary *summary);
+// Writes the held scopes and frames as Chrome trace-event JSON, viewable in
+// chrome://tracing or Perfetto.
+bool profileWriteTrace(const Profiler *profiler, const char *path);
+
+#endif
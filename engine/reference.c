@@ -0,0 +1,253 @@
+#include "reference.h"
+#include <string.h>
+
+typedef struct Pos {
+	int x;
+	int y;
+} Pos;
+
+// Tiles are never moved in place: every tile's slide is worked out from the
+// board as it was before the move, and results go to a copy.
+void referenceMove(int nums[BHEIGHT][BWIDTH], Direction dir, int *score, int deltas[BHEIGHT][BWIDTH]) {
+	int newNums[BHEIGHT][BWIDTH];
+	memcpy(newNums, nums, sizeof(newNums));
+	memset(deltas, 0, sizeof(int) * BHEIGHT * BWIDTH);
+
+	// Both tiles of every merge, in the order they were found. Each line can
+	// hold BWIDTH / 2 merges, so this needs one slot per cell.
+	Pos mergings[BWIDTH * BHEIGHT];
+	int mergeCount = 0;
+
+	switch (dir) {
+	case MOVE_UP:
+		for (int i = 1; i < BHEIGHT; ++i) {
+			for (int j = 0; j < BWIDTH; ++j) {
+				int value = nums[i][j];
+
+				if (value == 0) continue;
+
+				int delta = 0;
+				bool willCombine = false;
+				int nextNum = 0;
+				int mergeTilesSeen = 0;
+
+				for (int k = i - 1; k >= 0; --k) {
+					int collidedValue = nums[k][j];
+					bool mergeAhead = false;
+
+					if (collidedValue == 0) {
+						delta++;
+						continue;
+					}
+
+					if (nextNum == 0) {
+						nextNum = collidedValue;
+					} else {
+						nextNum = -1;
+					}
+
+					for (int s = 0; s < mergeCount; ++s) {
+						if (mergings[s].x == j && mergings[s].y == k) {
+							mergeAhead = true;
+							mergeTilesSeen++;
+							break;
+						}
+					}
+
+					if (mergeAhead) {
+						if (mergeTilesSeen % 2 == 1) delta++;
+						continue;
+					}
+
+					if (nextNum == value && willCombine == false) {
+						delta++;
+						willCombine = true;
+						mergings[mergeCount++] = (Pos){j, k};
+						mergings[mergeCount++] = (Pos){j, i};
+					}
+				}
+
+				deltas[i][j] = delta;
+				if (delta > 0) {
+					newNums[i][j] = 0;
+					newNums[i - delta][j] = willCombine ? value + value : value;
+					if (willCombine) *score += value * SCORE_MULT;
+				}
+			}
+		}
+		break;
+	case MOVE_DOWN:
+		for (int i = BHEIGHT - 2; i >= 0; --i) {
+			for (int j = 0; j < BWIDTH; ++j) {
+				int value = nums[i][j];
+
+				if (value == 0) continue;
+
+				int delta = 0;
+				bool willCombine = false;
+				int nextNum = 0;
+				int mergeTilesSeen = 0;
+
+				for (int k = i + 1; k < BHEIGHT; ++k) {
+					int collidedValue = nums[k][j];
+					bool mergeAhead = false;
+
+					if (collidedValue == 0) {
+						delta++;
+						continue;
+					}
+
+					if (nextNum == 0) {
+						nextNum = collidedValue;
+					} else {
+						nextNum = -1;
+					}
+
+					for (int s = 0; s < mergeCount; ++s) {
+						if (mergings[s].x == j && mergings[s].y == k) {
+							mergeAhead = true;
+							mergeTilesSeen++;
+							break;
+						}
+					}
+
+					if (mergeAhead) {
+						if (mergeTilesSeen % 2 == 1) delta++;
+						continue;
+					}
+
+					if (nextNum == value && willCombine == false) {
+						delta++;
+						willCombine = true;
+						mergings[mergeCount++] = (Pos){j, k};
+						mergings[mergeCount++] = (Pos){j, i};
+					}
+				}
+
+				deltas[i][j] = delta;
+				if (delta > 0) {
+					newNums[i][j] = 0;
+					newNums[i + delta][j] = willCombine ? value + value : value;
+					if (willCombine) *score += value * SCORE_MULT;
+				}
+			}
+		}
+		break;
+	case MOVE_LEFT:
+		for (int j = 1; j < BWIDTH; ++j) {
+			for (int i = 0; i < BHEIGHT; ++i) {
+				int value = nums[i][j];
+
+				if (value == 0) continue;
+
+				int delta = 0;
+				bool willCombine = false;
+				int nextNum = 0;
+				int mergeTilesSeen = 0;
+
+				for (int k = j - 1; k >= 0; --k) {
+					int collidedValue = nums[i][k];
+					bool mergeAhead = false;
+
+					if (collidedValue == 0) {
+						delta++;
+						continue;
+					}
+
+					if (nextNum == 0) {
+						nextNum = collidedValue;
+					} else {
+						nextNum = -1;
+					}
+
+					for (int s = 0; s < mergeCount; ++s) {
+						if (mergings[s].x == k && mergings[s].y == i) {
+							mergeAhead = true;
+							mergeTilesSeen++;
+							break;
+						}
+					}
+
+					if (mergeAhead) {
+						if (mergeTilesSeen % 2 == 1) delta++;
+						continue;
+					}
+
+					if (nextNum == value && willCombine == false) {
+						delta++;
+						willCombine = true;
+						mergings[mergeCount++] = (Pos){k, i};
+						mergings[mergeCount++] = (Pos){j, i};
+					}
+				}
+
+				deltas[i][j] = delta;
+				if (delta > 0) {
+					newNums[i][j] = 0;
+					newNums[i][j - delta] = willCombine ? value + value : value;
+					if (willCombine) *score += value * SCORE_MULT;
+				}
+			}
+		}
+		break;
+	case MOVE_RIGHT:
+		for (int j = BWIDTH - 2; j >= 0; --j) {
+			for (int i = 0; i < BHEIGHT; ++i) {
+				int value = nums[i][j];
+
+				if (value == 0) continue;
+
+				int delta = 0;
+				bool willCombine = false;
+				int nextNum = 0;
+				int mergeTilesSeen = 0;
+
+				for (int k = j + 1; k < BWIDTH; ++k) {
+					int collidedValue = nums[i][k];
+					bool mergeAhead = false;
+
+					if (collidedValue == 0) {
+						delta++;
+						continue;
+					}
+
+					if (nextNum == 0) {
+						nextNum = collidedValue;
+					} else {
+						nextNum = -1;
+					}
+
+					for (int s = 0; s < mergeCount; ++s) {
+						if (mergings[s].x == k && mergings[s].y == i) {
+							mergeAhead = true;
+							mergeTilesSeen++;
+							break;
+						}
+					}
+
+					if (mergeAhead) {
+						if (mergeTilesSeen % 2 == 1) delta++;
+						continue;
+					}
+
+					if (nextNum == value && willCombine == false) {
+						delta++;
+						willCombine = true;
+						mergings[mergeCount++] = (Pos){k, i};
+						mergings[mergeCount++] = (Pos){j, i};
+					}
+				}
+
+				deltas[i][j] = delta;
+				if (delta > 0) {
+					newNums[i][j] = 0;
+					newNums[i][j + delta] = willCombine ? value + value : value;
+					if (willCombine) *score += value * SCORE_MULT;
+				}
+			}
+		}
+		break;
+	}
+
+	memcpy(nums, newNums, sizeof(newNums));
+}
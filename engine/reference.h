@@ -0,0 +1,12 @@
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include "board.h"
+
+// The game's original move code, one hand-written loop per direction working
+// on plain tile values, kept as the oracle that the packed engine is checked
+// against. It has no exponent cap, so only compare boards without 32768 tiles.
+// Fills deltas with how many cells each tile of the old board slides.
+void referenceMove(int nums[BHEIGHT][BWIDTH], Direction dir, int *score, int deltas[BHEIGHT][BWIDTH]);
+
+#endif
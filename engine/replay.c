@@ -0,0 +1,214 @@
+#include "replay.h"
+#include "byte_order.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_FIXED_SIZE 25
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t *data, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+	return hash;
+}
+
+// Grows *buffer to hold at least size bytes, doubling to keep appends cheap.
+static bool reserve(uint8_t **buffer, size_t *capacity, size_t size) {
+	if (size <= *capacity) return true;
+	size_t newCapacity = *capacity ? *capacity : 256;
+	while (newCapacity < size) newCapacity *= 2;
+	uint8_t *grown = realloc(*buffer, newCapacity);
+	if (grown == NULL) return false;
+	*buffer = grown;
+	*capacity = newCapacity;
+	return true;
+}
+
+static size_t moveBytes(uint32_t moveCount) {
+	return (moveCount + 3) / 4;
+}
+
+static size_t spawnBytes(const ReplayGame *game) {
+	return game->flags & REPLAY_SPAWNS ? game->moveCount + 2 : 0;
+}
+
+bool replayWriterOpen(ReplayWriter *writer, const char *path) {
+	memset(writer, 0, sizeof(*writer));
+	writer->file = fopen(path, "wb");
+	if (writer->file == NULL) return false;
+
+	uint8_t header[REPLAY_HEADER_SIZE] = {0};
+	memcpy(header, REPLAY_MAGIC, 4);
+	putLE(header + 4, REPLAY_VERSION, 2);
+	if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header)) writer->failed = true;
+	return !writer->failed;
+}
+
+bool replayWriterClose(ReplayWriter *writer) {
+	if (writer->file == NULL) return false;
+	if (fclose(writer->file) != 0) writer->failed = true;
+	writer->file = NULL;
+	free(writer->game.moves);
+	free(writer->game.spawns);
+	writer->game.moves = NULL;
+	writer->game.spawns = NULL;
+	return !writer->failed;
+}
+
+void replayBegin(ReplayWriter *writer, uint64_t seed, uint64_t stream, bool storeSpawns) {
+	writer->game.seed = seed;
+	writer->game.stream = stream;
+	writer->game.moveCount = 0;
+	writer->game.score = 0;
+	writer->game.flags = storeSpawns ? REPLAY_SPAWNS : 0;
+	writer->spawnCount = 0;
+	writer->recording = true;
+}
+
+void replayAddMove(ReplayWriter *writer, Direction dir) {
+	ReplayGame *game = &writer->game;
+	if (!writer->recording || game->moveCount == REPLAY_MAX_MOVES) return;
+	if (!reserve(&game->moves, &game->moveCapacity, moveBytes(game->moveCount + 1))) {
+		writer->failed = true;
+		return;
+	}
+
+	int shift = (game->moveCount & 3) * 2;
+	uint8_t *byte = &game->moves[game->moveCount >> 2];
+	if (shift == 0) *byte = 0;
+	*byte |= (uint8_t)(dir << shift);
+	game->moveCount++;
+}
+
+void replayAddSpawn(ReplayWriter *writer, int cell, int num) {
+	ReplayGame *game = &writer->game;
+	if (!writer->recording || !(game->flags & REPLAY_SPAWNS)) return;
+	if (!reserve(&game->spawns, &game->spawnCapacity, writer->spawnCount + 1)) {
+		writer->failed = true;
+		return;
+	}
+	game->spawns[writer->spawnCount++] = (uint8_t)(cell | (num == 4) << 4);
+}
+
+bool replayEnd(ReplayWriter *writer, int score) {
+	ReplayGame *game = &writer->game;
+	if (!writer->recording) return false;
+	writer->recording = false;
+	game->score = (uint32_t)score;
+
+	// A game cut short right after a move has one spawn fewer than the format expects
+	if ((game->flags & REPLAY_SPAWNS) && writer->spawnCount != game->moveCount + 2) {
+		game->flags &= ~REPLAY_SPAWNS;
+	}
+
+	uint8_t fixed[RECORD_FIXED_SIZE];
+	putLE(fixed, game->seed, 8);
+	putLE(fixed + 8, game->stream, 8);
+	putLE(fixed + 16, game->moveCount, 4);
+	putLE(fixed + 20, game->score, 4);
+	fixed[24] = game->flags;
+
+	uint32_t hash = fnv1a(2166136261u, fixed, sizeof(fixed));
+	hash = fnv1a(hash, game->moves, moveBytes(game->moveCount));
+	hash = fnv1a(hash, game->spawns, spawnBytes(game));
+	uint8_t checksum[4];
+	putLE(checksum, hash, 4);
+
+	if (fwrite(fixed, 1, sizeof(fixed), writer->file) != sizeof(fixed)
+		|| fwrite(game->moves, 1, moveBytes(game->moveCount), writer->file) != moveBytes(game->moveCount)
+		|| fwrite(game->spawns, 1, spawnBytes(game), writer->file) != spawnBytes(game)
+		|| fwrite(checksum, 1, sizeof(checksum), writer->file) != sizeof(checksum)
+		|| fflush(writer->file) != 0) {
+		writer->failed = true;
+	}
+	return !writer->failed;
+}
+
+bool replayReaderOpen(ReplayReader *reader, const char *path) {
+	memset(reader, 0, sizeof(*reader));
+	reader->file = fopen(path, "rb");
+	if (reader->file == NULL) return false;
+
+	uint8_t header[REPLAY_HEADER_SIZE];
+	if (fread(header, 1, sizeof(header), reader->file) != sizeof(header)
+		|| memcmp(header, REPLAY_MAGIC, 4) != 0
+		|| getLE(header + 4, 2) != REPLAY_VERSION) {
+		replayReaderClose(reader);
+		return false;
+	}
+	return true;
+}
+
+void replayReaderClose(ReplayReader *reader) {
+	if (reader->file != NULL) fclose(reader->file);
+	reader->file = NULL;
+	free(reader->game.moves);
+	free(reader->game.spawns);
+	reader->game.moves = NULL;
+	reader->game.spawns = NULL;
+}
+
+ReplayStatus replayRead(ReplayReader *reader) {
+	ReplayGame *game = &reader->game;
+	uint8_t fixed[RECORD_FIXED_SIZE];
+	size_t got = fread(fixed, 1, sizeof(fixed), reader->file);
+	if (got == 0 && feof(reader->file)) return REPLAY_END;
+	if (got != sizeof(fixed)) return REPLAY_CORRUPT;
+
+	game->seed = getLE(fixed, 8);
+	game->stream = getLE(fixed + 8, 8);
+	game->moveCount = (uint32_t)getLE(fixed + 16, 4);
+	game->score = (uint32_t)getLE(fixed + 20, 4);
+	game->flags = fixed[24];
+	if (game->moveCount > REPLAY_MAX_MOVES || (game->flags & ~REPLAY_SPAWNS)) return REPLAY_CORRUPT;
+
+	size_t movesSize = moveBytes(game->moveCount);
+	size_t spawnsSize = spawnBytes(game);
+	if (!reserve(&game->moves, &game->moveCapacity, movesSize)
+		|| !reserve(&game->spawns, &game->spawnCapacity, spawnsSize)) {
+		return REPLAY_CORRUPT;
+	}
+
+	uint8_t checksum[4];
+	if (fread(game->moves, 1, movesSize, reader->file) != movesSize
+		|| fread(game->spawns, 1, spawnsSize, reader->file) != spawnsSize
+		|| fread(checksum, 1, sizeof(checksum), reader->file) != sizeof(checksum)) {
+		return REPLAY_CORRUPT;
+	}
+
+	uint32_t hash = fnv1a(2166136261u, fixed, sizeof(fixed));
+	hash = fnv1a(hash, game->moves, movesSize);
+	hash = fnv1a(hash, game->spawns, spawnsSize);
+	return hash == getLE(checksum, 4) ? REPLAY_OK : REPLAY_CORRUPT;
+}
+
+static bool placeSpawn(Game *game, uint8_t spawn) {
+	int cell = spawn & 0xF;
+	int exp = (spawn >> 4) + 1;
+	if (exp > 2 || boardGetExp(game->board, cell / BWIDTH, cell % BWIDTH) != 0) return false;
+	game->board = boardSetExp(game->board, cell / BWIDTH, cell % BWIDTH, exp);
+	return true;
+}
+
+bool replayRun(const ReplayGame *record, Game *game) {
+	bool stored = record->flags & REPLAY_SPAWNS;
+	int cell;
+	gameReset(game, record->seed, record->stream);
+
+	if (stored) {
+		if (!placeSpawn(game, record->spawns[0]) || !placeSpawn(game, record->spawns[1])) return false;
+	} else {
+		gameSpawn(game, &cell);
+		gameSpawn(game, &cell);
+	}
+
+	for (uint32_t n = 0; n < record->moveCount; ++n) {
+		if (!gameMove(game, replayGetMove(record, n))) return false;
+		if (stored) {
+			if (!placeSpawn(game, record->spawns[n + 2])) return false;
+		} else {
+			gameSpawn(game, &cell);
+		}
+	}
+	return (uint32_t)game->score == record->score;
+}
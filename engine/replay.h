@@ -0,0 +1,84 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+#include <stdio.h>
+
+// A replay file is an 8 byte header ("2RPL", version, reserved) followed by
+// one record per game, all little-endian:
+//   u64 seed, u64 stream, u32 moveCount, u32 score, u8 flags,
+//   moves: ceil(moveCount / 4) bytes, 2 bits each, first move in the low bits,
+//   spawns (REPLAY_SPAWNS only): moveCount + 2 bytes, cell | (tile is a 4) << 4,
+//   u32 FNV-1a checksum of everything from seed to the last spawn.
+// Only moves that changed the board are stored, each followed by one spawn.
+#define REPLAY_MAGIC "2RPL"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 8
+// Records claiming more moves than this are treated as corrupt
+#define REPLAY_MAX_MOVES (1 << 26)
+
+// Record flag: the spawned tiles are stored, so the game can be checked
+// without trusting the generator.
+#define REPLAY_SPAWNS 1
+
+typedef enum ReplayStatus {
+	REPLAY_OK,
+	REPLAY_END,
+	REPLAY_CORRUPT
+} ReplayStatus;
+
+typedef struct ReplayGame {
+	uint64_t seed;
+	uint64_t stream;
+	uint32_t moveCount;
+	uint32_t score;
+	uint8_t flags;
+	uint8_t *moves;
+	uint8_t *spawns;
+	// Allocated sizes of moves and spawns
+	size_t moveCapacity;
+	size_t spawnCapacity;
+} ReplayGame;
+
+// Writes one game at a time. A record is only written out, whole, by
+// replayEnd, so an interrupted game never leaves a partial record behind.
+typedef struct ReplayWriter {
+	FILE *file;
+	ReplayGame game;
+	uint32_t spawnCount;
+	bool recording;
+	bool failed;
+} ReplayWriter;
+
+typedef struct ReplayReader {
+	FILE *file;
+	ReplayGame game;
+} ReplayReader;
+
+// Creates or truncates path and writes the file header.
+bool replayWriterOpen(ReplayWriter *writer, const char *path);
+// Drops any game still being recorded. Returns false if any write failed.
+bool replayWriterClose(ReplayWriter *writer);
+void replayBegin(ReplayWriter *writer, uint64_t seed, uint64_t stream, bool storeSpawns);
+void replayAddMove(ReplayWriter *writer, Direction dir);
+// num is the spawned tile's value, 2 or 4, as returned by gameSpawn.
+void replayAddSpawn(ReplayWriter *writer, int cell, int num);
+// Writes the record of the current game and flushes it.
+bool replayEnd(ReplayWriter *writer, int score);
+
+bool replayReaderOpen(ReplayReader *reader, const char *path);
+void replayReaderClose(ReplayReader *reader);
+// Reads the next record into reader->game, which stays valid until the next call.
+ReplayStatus replayRead(ReplayReader *reader);
+
+static inline Direction replayGetMove(const ReplayGame *game, uint32_t index) {
+	return (Direction)((game->moves[index >> 2] >> ((index & 3) * 2)) & 3);
+}
+
+// Plays a record from the start into game. Spawns come from the stored tiles
+// when the record has them and from the generator otherwise. Returns false
+// if a move does not change the board, a stored spawn lands on a taken cell,
+// or the final score differs from the recorded one.
+bool replayRun(const ReplayGame *record, Game *game);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// xoshiro256**. The state is seeded by expanding a 64-bit seed with
+// SplitMix64. Independent streams come either from rngSeedStream, which
+// hashes a stream index into the seed (cheap for millions of games), or
+// from rngJump, which advances a generator by 2^128 steps so the streams
+// are guaranteed never to overlap.
+typedef struct Rng {
+	uint64_t s[4];
+} Rng;
+
+static inline uint64_t rngMix(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static inline uint64_t rngRotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rngNext(Rng *rng) {
+	uint64_t *s = rng->s;
+	uint64_t result = rngRotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rngRotl(s[3], 45);
+	return result;
+}
+
+static inline void rngSeed(Rng *rng, uint64_t seed) {
+	for (int i = 0; i < 4; ++i) {
+		seed += 0x9E3779B97F4A7C15ULL;
+		rng->s[i] = rngMix(seed);
+	}
+}
+
+static inline void rngSeedStream(Rng *rng, uint64_t seed, uint64_t stream) {
+	rngSeed(rng, stream ? seed ^ rngMix(stream + 0x632BE59BD9B4E019ULL) : seed);
+}
+
+static inline void rngJump(Rng *rng) {
+	static const uint64_t jump[4] = {
+		0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+		0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+	};
+	uint64_t s[4] = {0};
+	for (int i = 0; i < 4; ++i) {
+		for (int b = 0; b < 64; ++b) {
+			if (jump[i] & (1ULL << b)) {
+				for (int k = 0; k < 4; ++k) s[k] ^= rng->s[k];
+			}
+			rngNext(rng);
+		}
+	}
+	for (int k = 0; k < 4; ++k) rng->s[k] = s[k];
+}
+
+// Uniform value in [0, n).
+static inline uint32_t rngBelow(Rng *rng, uint32_t n) {
+	return (uint32_t)(((rngNext(rng) >> 32) * n) >> 32);
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "sim.h"
+#include "platform.h"
+
+#include <string.h>
+
+// Each worker owns a range of chunk indices packed as (begin << 32 | end). The
+// owner takes chunks from the front; idle workers steal the back half of a
+// victim's range with a single compare-and-swap.
+typedef struct Worker {
+	volatile int64_t range;
+	int index;
+	int count;
+	struct Worker *all;
+	const SimConfig *config;
+	SimStats *stats;
+	void *ctx;
+	char pad[16];
+} Worker;
+
+static int64_t packRange(int64_t begin, int64_t end) {
+	return (begin << 32) | end;
+}
+
+static bool popChunk(Worker *worker, int64_t *chunk) {
+	for (;;) {
+		int64_t range = atomicLoad64(&worker->range);
+		int64_t begin = range >> 32;
+		int64_t end = range & 0xFFFFFFFF;
+		if (begin >= end) return false;
+		if (atomicCas64(&worker->range, range, packRange(begin + 1, end))) {
+			*chunk = begin;
+			return true;
+		}
+	}
+}
+
+static bool stealChunk(Worker *worker, int64_t *chunk) {
+	for (int k = 1; k < worker->count; ++k) {
+		Worker *victim = &worker->all[(worker->index + k) % worker->count];
+		for (;;) {
+			int64_t range = atomicLoad64(&victim->range);
+			int64_t begin = range >> 32;
+			int64_t end = range & 0xFFFFFFFF;
+			if (begin >= end) break;
+
+			int64_t split = end - (end - begin + 1) / 2;
+			if (atomicCas64(&victim->range, range, packRange(begin, split))) {
+				*chunk = split;
+				atomicStore64(&worker->range, packRange(split + 1, end));
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void simPlayGame(Game *game, uint64_t seed, uint64_t stream, Policy policy, void *ctx) {
+	int cell;
+	gameReset(game, seed, stream);
+	gameSpawn(game, &cell);
+	gameSpawn(game, &cell);
+
+	while (!gameIsOver(game)) {
+		if (!gameMove(game, policy(game->board, &game->rng, ctx))) break;
+		gameSpawn(game, &cell);
+	}
+}
+
+static void workerRun(void *arg) {
+	Worker *worker = arg;
+	const SimConfig *config = worker->config;
+	SimStats local;
+	memset(&local, 0, sizeof(local));
+
+	// Leave this worker's chunks to be stolen by the others
+	if (config->threadInit && worker->ctx == NULL) return;
+
+	int64_t chunk;
+	while (popChunk(worker, &chunk) || stealChunk(worker, &chunk)) {
+		int64_t first = chunk * SIM_CHUNK;
+		int64_t last = first + SIM_CHUNK;
+		if (last > config->games) last = config->games;
+
+		for (int64_t n = first; n < last; ++n) {
+			Game game;
+			simPlayGame(&game, config->seed, n, config->policy, worker->ctx);
+
+			local.games++;
+			local.moves += game.moveCount;
+			local.totalScore += game.score;
+			if (game.score > local.bestScore) local.bestScore = game.score;
+			local.maxTile[boardMaxExp(game.board)]++;
+		}
+	}
+
+	SimStats *stats = worker->stats;
+	atomicAdd64(&stats->games, local.games);
+	atomicAdd64(&stats->moves, local.moves);
+	atomicAdd64(&stats->totalScore, local.totalScore);
+	atomicMax64(&stats->bestScore, local.bestScore);
+	for (int i = 0; i < 16; ++i) {
+		if (local.maxTile[i]) atomicAdd64(&stats->maxTile[i], local.maxTile[i]);
+	}
+}
+
+void simRun(const SimConfig *config, SimStats *stats) {
+	Worker workers[SIM_MAX_THREADS];
+
+	int count = config->threads > 0 ? config->threads : cpuCount();
+	if (count > SIM_MAX_THREADS) count = SIM_MAX_THREADS;
+
+	boardInit();
+
+	int64_t chunks = (config->games + SIM_CHUNK - 1) / SIM_CHUNK;
+	for (int i = 0; i < count; ++i) {
+		workers[i] = (Worker){0};
+		workers[i].range = packRange(chunks * i / count, chunks * (i + 1) / count);
+		workers[i].index = i;
+		workers[i].count = count;
+		workers[i].all = workers;
+		workers[i].config = config;
+		workers[i].stats = stats;
+		// Contexts are built up front so policies can set up shared tables safely
+		workers[i].ctx = config->threadInit ? config->threadInit(config->policyCtx) : config->policyCtx;
+	}
+
+	runWorkers(count, workerRun, workers, sizeof(Worker));
+
+	if (config->threadFree) {
+		for (int i = 0; i < count; ++i) {
+			config->threadFree(workers[i].ctx);
+		}
+	}
+}
+
+Direction policyRandom(Board board, Rng *rng, void *ctx) {
+	Direction legal[DIR_COUNT];
+	int count = 0;
+	int moves = boardLegalMoves(board);
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		if (moves & (1 << dir)) legal[count++] = dir;
+	}
+	return count ? legal[rngBelow(rng, count)] : MOVE_UP;
+}
+
+Direction policyGreedy(Board board, Rng *rng, void *ctx) {
+	Direction best = MOVE_UP;
+	int bestScore = -1;
+	int bestEmpty = -1;
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		int score = 0;
+		Board moved = boardMove(board, dir, &score);
+		if (moved == board) continue;
+
+		int empty = boardEmptyCount(moved);
+		if (score > bestScore || (score == bestScore && empty > bestEmpty)) {
+			best = dir;
+			bestScore = score;
+			bestEmpty = empty;
+		}
+	}
+	return best;
+}
@@ -0,0 +1,46 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "game.h"
+#include "rng.h"
+
+// Number of games handed out per unit of work.
+#define SIM_CHUNK 64
+#define SIM_MAX_THREADS 256
+
+// Picks the next move. Only called on boards that are not game over and must
+// return a move that changes the board. ctx is shared by all worker threads
+// unless the config supplies threadInit.
+typedef Direction (*Policy)(Board board, Rng *rng, void *ctx);
+
+typedef struct SimConfig {
+	int64_t games;
+	int threads; // 0 uses one thread per CPU
+	uint64_t seed;
+	Policy policy;
+	void *policyCtx;
+	// Optional: builds a private policy context for each worker from policyCtx,
+	// for policies that keep per-thread state such as search node counts.
+	void *(*threadInit)(void *policyCtx);
+	void (*threadFree)(void *threadCtx);
+} SimConfig;
+
+typedef struct SimStats {
+	int64_t games;
+	int64_t moves;
+	int64_t totalScore;
+	int64_t bestScore;
+	int64_t maxTile[16]; // game count by the exponent of the highest tile reached
+} SimStats;
+
+// Plays one game from an empty board until no move is left. The policy draws
+// from the game's generator.
+void simPlayGame(Game *game, uint64_t seed, uint64_t stream, Policy policy, void *ctx);
+// Plays config->games games across a work-stealing pool and accumulates into stats.
+// Game n always draws from RNG stream n, so results do not depend on scheduling.
+void simRun(const SimConfig *config, SimStats *stats);
+
+Direction policyRandom(Board board, Rng *rng, void *ctx);
+Direction policyGreedy(Board board, Rng *rng, void *ctx);
+
+#endif
@@ -0,0 +1,139 @@
+#include "sized.h"
+#include "board_tables.h"
+#include <stddef.h>
+
+#ifdef _MSC_VER
+#define SIZED_INLINE static __forceinline
+#else
+#define SIZED_INLINE static inline __attribute__((always_inline))
+#endif
+
+#define SIZED_PASTE(name, w, h) name##w##x##h
+#define SIZED_NAME(name, w, h) SIZED_PASTE(name, w, h)
+#define SZ(name) SIZED_NAME(name, SIZED_WIDTH, SIZED_HEIGHT)
+
+// Low n bits set, for 1 <= n <= 64.
+#define SIZED_LOW_BITS(n) ((((uint64_t)1 << ((n) - 1)) << 1) - 1)
+
+// Sets the top bit of every field of w that is zero. lows has the bits below
+// each field's top bit set and highs the top bits.
+SIZED_INLINE uint64_t zeroFields(uint64_t w, uint64_t lows, uint64_t highs) {
+	return ~(((w & lows) + lows) | w) & highs;
+}
+
+SIZED_INLINE int popcount64(uint64_t x) {
+	x = x - ((x >> 1) & 0x5555555555555555ULL);
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+// Directions made legal by the pairs flagged in mask, where b holds each
+// cell's neighbour further from the towardA wall. capped has every field at
+// the maximum exponent.
+SIZED_INLINE int pairMoves(uint64_t a, uint64_t b, uint64_t mask, uint64_t lows, uint64_t highs,
+	uint64_t capped, Direction towardA, Direction towardB) {
+	uint64_t emptyA = zeroFields(a, lows, highs) & mask;
+	uint64_t emptyB = zeroFields(b, lows, highs) & mask;
+	uint64_t same = zeroFields(a ^ b, lows, highs) & ~zeroFields(a ^ capped, lows, highs) & mask & ~emptyA;
+	int legal = 0;
+	if (emptyA & ~emptyB) legal |= 1 << towardA;
+	if (emptyB & ~emptyA) legal |= 1 << towardB;
+	if (same) legal |= (1 << towardA) | (1 << towardB);
+	return legal;
+}
+
+// Slides cells[0, length) towards index 0 with the same rules as rowMoveLeft
+// in board.c. Returns whether any cell changed.
+SIZED_INLINE bool slideLine(uint8_t *cells, int length, int maxExp, int64_t *score) {
+	uint8_t out[SIZED_MAX] = {0};
+	int count = 0;
+	bool canMerge = false;
+
+	for (int p = 0; p < length; ++p) {
+		int exp = cells[p];
+		if (exp == 0) continue;
+
+		if (canMerge && out[count - 1] == exp && exp < maxExp) {
+			out[count - 1]++;
+			*score += ((int64_t)1 << exp) * SCORE_MULT;
+			canMerge = false;
+		} else {
+			out[count++] = (uint8_t)exp;
+			canMerge = true;
+		}
+	}
+
+	bool changed = false;
+	for (int p = 0; p < length; ++p) {
+		changed |= cells[p] != out[p];
+		cells[p] = out[p];
+	}
+	return changed;
+}
+
+#define SIZED_WIDTH 3
+#define SIZED_HEIGHT 3
+#define SIZED_NIBBLES 1
+#include "sized_impl.h"
+
+#define SIZED_WIDTH 4
+#define SIZED_HEIGHT 4
+#define SIZED_NIBBLES 1
+#include "sized_impl.h"
+
+#define SIZED_WIDTH 5
+#define SIZED_HEIGHT 5
+#define SIZED_NIBBLES 0
+#include "sized_impl.h"
+
+#define SIZED_WIDTH 6
+#define SIZED_HEIGHT 6
+#define SIZED_NIBBLES 0
+#include "sized_impl.h"
+
+#define SIZED_WIDTH 7
+#define SIZED_HEIGHT 7
+#define SIZED_NIBBLES 0
+#include "sized_impl.h"
+
+#define SIZED_WIDTH 8
+#define SIZED_HEIGHT 8
+#define SIZED_NIBBLES 0
+#include "sized_impl.h"
+
+#define SIZED_OPS(w, h) { \
+	w, h, SIZED_NAME(maxExp, w, h), \
+	SIZED_NAME(getExp, w, h), SIZED_NAME(setExp, w, h), SIZED_NAME(move, w, h), \
+	SIZED_NAME(spawn, w, h), SIZED_NAME(legalMoves, w, h), SIZED_NAME(emptyCount, w, h), \
+	SIZED_NAME(playRandom, w, h), SIZED_NAME(playGreedy, w, h) \
+}
+
+static const SizedOps sizedTable[] = {
+	SIZED_OPS(3, 3),
+	SIZED_OPS(4, 4),
+	SIZED_OPS(5, 5),
+	SIZED_OPS(6, 6),
+	SIZED_OPS(7, 7),
+	SIZED_OPS(8, 8),
+};
+
+static bool sizedReady = false;
+
+void sizedInit(void) {
+	if (sizedReady) return;
+	init3x3();
+	init4x4();
+	init5x5();
+	init6x6();
+	init7x7();
+	init8x8();
+	sizedReady = true;
+}
+
+const SizedOps *sizedOps(int width, int height) {
+	for (int i = 0; i < (int)(sizeof(sizedTable) / sizeof(sizedTable[0])); ++i) {
+		if (sizedTable[i].width == width && sizedTable[i].height == height) return &sizedTable[i];
+	}
+	return NULL;
+}
@@ -0,0 +1,51 @@
+#ifndef SIZED_H
+#define SIZED_H
+
+#include "board.h"
+#include "rng.h"
+
+// Square boards from SIZED_MIN x SIZED_MIN to SIZED_MAX x SIZED_MAX. Each size
+// is compiled separately from one template so its loops see constant
+// dimensions; sizedOps picks the variant at run time.
+#define SIZED_MIN 3
+#define SIZED_MAX 8
+
+// 3x3 and 4x4 boards keep 4-bit exponents packed in rows[0] like Board does,
+// with row i at bit 4 * width * i, and move through row lookup tables. Larger
+// boards store one byte per cell and one word per row (byte j is column j),
+// so tiles can grow far past 2^15.
+typedef struct SizedBoard {
+	uint64_t rows[SIZED_MAX];
+} SizedBoard;
+
+typedef struct SizedResult {
+	int64_t moves;
+	int64_t score;
+	int maxExp;
+} SizedResult;
+
+typedef struct SizedOps {
+	int width;
+	int height;
+	int maxExp; // cells at this exponent no longer merge
+	int (*getExp)(const SizedBoard *board, int i, int j);
+	void (*setExp)(SizedBoard *board, int i, int j, int exp);
+	// Moves in place, adding merge points to *score. Returns whether anything moved.
+	bool (*move)(SizedBoard *board, Direction dir, int64_t *score);
+	// Same rules as boardSpawn. Returns the cell index (i * width + j) or -1.
+	int (*spawn)(SizedBoard *board, uint32_t random);
+	// Bit (1 << dir) is set for every direction that would change the board.
+	int (*legalMoves)(const SizedBoard *board);
+	int (*emptyCount)(const SizedBoard *board);
+	// Plays a whole game of uniformly random legal moves from an empty board.
+	void (*playRandom)(Rng *rng, SizedResult *result);
+	// Plays a whole game with the choices of policyGreedy.
+	void (*playGreedy)(Rng *rng, SizedResult *result);
+} SizedOps;
+
+// Builds the lookup tables of every size. Must run before any sized move.
+void sizedInit(void);
+// Returns NULL when no variant exists for the size.
+const SizedOps *sizedOps(int width, int height);
+
+#endif
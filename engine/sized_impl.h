@@ -0,0 +1,300 @@
+// Board code for one size. sized.c includes this once per variant with
+// SIZED_WIDTH, SIZED_HEIGHT and SIZED_NIBBLES defined; every name gets a
+// WxH suffix through SZ. Internal to the engine.
+
+#if SIZED_NIBBLES && SIZED_WIDTH != SIZED_HEIGHT
+#error "packed variants look up rows and columns in the same table"
+#endif
+
+#if SIZED_NIBBLES
+#define SIZED_ROW_BITS (4 * SIZED_WIDTH)
+#define SIZED_MAX_EXP 0xF
+#define SIZED_LOWS 0x7777777777777777ULL
+#define SIZED_HIGHS 0x8888888888888888ULL
+#define SIZED_CAPPED 0xFFFFFFFFFFFFFFFFULL
+// Top bits of every cell of the board, of cells with a right neighbour and of
+// cells with one below
+#define SIZED_CELLS (SIZED_LOW_BITS(SIZED_ROW_BITS * SIZED_HEIGHT) & SIZED_HIGHS)
+#define SIZED_PAIRS_H (SIZED_LOW_BITS(SIZED_ROW_BITS * SIZED_HEIGHT) / SIZED_LOW_BITS(SIZED_ROW_BITS) \
+	* (SIZED_LOW_BITS(4 * (SIZED_WIDTH - 1)) & SIZED_HIGHS))
+#define SIZED_PAIRS_V (SIZED_LOW_BITS(SIZED_ROW_BITS * (SIZED_HEIGHT - 1)) & SIZED_HIGHS)
+#else
+// Keeps merge points within int64_t
+#define SIZED_MAX_EXP 62
+#define SIZED_LOWS 0x7F7F7F7F7F7F7F7FULL
+#define SIZED_HIGHS 0x8080808080808080ULL
+#define SIZED_CAPPED 0x3E3E3E3E3E3E3E3EULL
+// Top bits of every cell of a row and of cells with a right neighbour
+#define SIZED_CELLS (SIZED_LOW_BITS(8 * SIZED_WIDTH) & SIZED_HIGHS)
+#define SIZED_PAIRS_H (SIZED_LOW_BITS(8 * (SIZED_WIDTH - 1)) & SIZED_HIGHS)
+#endif
+
+// 4x4 is the packed Board itself, so it moves through board.c
+#define SIZED_PACKED (SIZED_NIBBLES && SIZED_WIDTH == 4)
+
+enum { SZ(maxExp) = SIZED_MAX_EXP };
+
+#if SIZED_NIBBLES
+static int SZ(getExp)(const SizedBoard *board, int i, int j) {
+	return (board->rows[0] >> (SIZED_ROW_BITS * i + 4 * j)) & 0xF;
+}
+
+static void SZ(setExp)(SizedBoard *board, int i, int j, int exp) {
+	int shift = SIZED_ROW_BITS * i + 4 * j;
+	board->rows[0] = (board->rows[0] & ~(0xFULL << shift)) | ((uint64_t)(exp & 0xF) << shift);
+}
+
+#if SIZED_WIDTH == 4
+// 4x4 shares the packed engine's tables, which boardInit builds
+#define SIZED_LEFT_TABLE rowLeftTable
+#define SIZED_SCORE_TABLE rowScoreTable
+
+static void SZ(init)(void) {
+	boardInit();
+}
+#else
+static uint16_t SZ(rowLeft)[1 << SIZED_ROW_BITS];
+static uint32_t SZ(rowScore)[1 << SIZED_ROW_BITS];
+#define SIZED_LEFT_TABLE SZ(rowLeft)
+#define SIZED_SCORE_TABLE SZ(rowScore)
+
+static void SZ(init)(void) {
+	for (uint32_t row = 0; row < (1u << SIZED_ROW_BITS); ++row) {
+		uint8_t cells[SIZED_MAX];
+		for (int p = 0; p < SIZED_WIDTH; ++p) cells[p] = (row >> (4 * p)) & 0xF;
+		int64_t score = 0;
+		slideLine(cells, SIZED_WIDTH, SIZED_MAX_EXP, &score);
+
+		uint32_t slid = 0;
+		for (int p = 0; p < SIZED_WIDTH; ++p) slid |= (uint32_t)cells[p] << (4 * p);
+		SZ(rowLeft)[row] = (uint16_t)slid;
+		SZ(rowScore)[row] = (uint32_t)score;
+	}
+}
+#endif
+#else
+static int SZ(getExp)(const SizedBoard *board, int i, int j) {
+	return (board->rows[i] >> (8 * j)) & 0xFF;
+}
+
+static void SZ(setExp)(SizedBoard *board, int i, int j, int exp) {
+	int shift = 8 * j;
+	board->rows[i] = (board->rows[i] & ~(0xFFULL << shift)) | ((uint64_t)(exp & 0xFF) << shift);
+}
+
+static void SZ(init)(void) {
+}
+#endif
+
+// Cell p of a line, counting from the wall the tiles move towards.
+SIZED_INLINE void SZ(lineCell)(Direction dir, int line, int p, int *i, int *j) {
+	switch (dir) {
+	case MOVE_UP: *i = p; *j = line; break;
+	case MOVE_DOWN: *i = SIZED_HEIGHT - 1 - p; *j = line; break;
+	case MOVE_LEFT: *i = line; *j = p; break;
+	default: *i = line; *j = SIZED_WIDTH - 1 - p; break;
+	}
+}
+
+// Inlined once per direction by SZ(move) so dir is a constant here too.
+SIZED_INLINE bool SZ(moveDir)(SizedBoard *board, Direction dir, int64_t *score) {
+	const bool vertical = dir == MOVE_UP || dir == MOVE_DOWN;
+	const int lines = vertical ? SIZED_WIDTH : SIZED_HEIGHT;
+	const int length = vertical ? SIZED_HEIGHT : SIZED_WIDTH;
+	bool moved = false;
+
+	for (int line = 0; line < lines; ++line) {
+		uint8_t cells[SIZED_MAX];
+		for (int p = 0; p < length; ++p) {
+			int i, j;
+			SZ(lineCell)(dir, line, p, &i, &j);
+			cells[p] = (uint8_t)SZ(getExp)(board, i, j);
+		}
+
+#if SIZED_NIBBLES
+		uint32_t key = 0;
+		for (int p = 0; p < length; ++p) key |= (uint32_t)cells[p] << (4 * p);
+		uint32_t slid = SIZED_LEFT_TABLE[key];
+		if (slid == key) continue;
+		*score += SIZED_SCORE_TABLE[key];
+		for (int p = 0; p < length; ++p) cells[p] = (slid >> (4 * p)) & 0xF;
+#else
+		if (!slideLine(cells, length, SIZED_MAX_EXP, score)) continue;
+#endif
+
+		moved = true;
+		for (int p = 0; p < length; ++p) {
+			int i, j;
+			SZ(lineCell)(dir, line, p, &i, &j);
+			SZ(setExp)(board, i, j, cells[p]);
+		}
+	}
+	return moved;
+}
+
+static bool SZ(move)(SizedBoard *board, Direction dir, int64_t *score) {
+#if SIZED_PACKED
+	Board before = board->rows[0];
+	int points = 0;
+	board->rows[0] = boardMove(before, dir, &points);
+	*score += points;
+	return board->rows[0] != before;
+#else
+	switch (dir) {
+	case MOVE_UP: return SZ(moveDir)(board, MOVE_UP, score);
+	case MOVE_DOWN: return SZ(moveDir)(board, MOVE_DOWN, score);
+	case MOVE_LEFT: return SZ(moveDir)(board, MOVE_LEFT, score);
+	default: return SZ(moveDir)(board, MOVE_RIGHT, score);
+	}
+#endif
+}
+
+// A direction is legal when some neighbouring pair would slide or merge in
+// it; pairMoves checks a whole row or board of pairs at once.
+static int SZ(legalMoves)(const SizedBoard *board) {
+#if SIZED_PACKED
+	return boardLegalMoves(board->rows[0]);
+#elif SIZED_NIBBLES
+	uint64_t w = board->rows[0];
+	return pairMoves(w, w >> 4, SIZED_PAIRS_H, SIZED_LOWS, SIZED_HIGHS, SIZED_CAPPED, MOVE_LEFT, MOVE_RIGHT)
+		| pairMoves(w, w >> SIZED_ROW_BITS, SIZED_PAIRS_V, SIZED_LOWS, SIZED_HIGHS, SIZED_CAPPED, MOVE_UP, MOVE_DOWN);
+#else
+	int legal = 0;
+	for (int i = 0; i < SIZED_HEIGHT; ++i) {
+		uint64_t w = board->rows[i];
+		legal |= pairMoves(w, w >> 8, SIZED_PAIRS_H, SIZED_LOWS, SIZED_HIGHS, SIZED_CAPPED, MOVE_LEFT, MOVE_RIGHT);
+		if (i + 1 < SIZED_HEIGHT) {
+			legal |= pairMoves(w, board->rows[i + 1], SIZED_CELLS, SIZED_LOWS, SIZED_HIGHS, SIZED_CAPPED, MOVE_UP, MOVE_DOWN);
+		}
+	}
+	return legal;
+#endif
+}
+
+static int SZ(emptyCount)(const SizedBoard *board) {
+#if SIZED_NIBBLES
+	return popcount64(zeroFields(board->rows[0], SIZED_LOWS, SIZED_HIGHS) & SIZED_CELLS);
+#else
+	int empty = 0;
+	for (int i = 0; i < SIZED_HEIGHT; ++i) {
+		empty += popcount64(zeroFields(board->rows[i], SIZED_LOWS, SIZED_HIGHS) & SIZED_CELLS);
+	}
+	return empty;
+#endif
+}
+
+// Same rules as boardSpawn: spawnExp picks a 2 or a 4, random >> 1 the cell.
+static int SZ(spawn)(SizedBoard *board, uint32_t random) {
+#if SIZED_PACKED
+	int cell, exp;
+	board->rows[0] = boardSpawn(board->rows[0], random, &cell, &exp);
+	return cell;
+#elif SIZED_NIBBLES
+	uint64_t empty = zeroFields(board->rows[0], SIZED_LOWS, SIZED_HIGHS) & SIZED_CELLS;
+	int count = popcount64(empty);
+	if (count == 0) return -1;
+
+	for (int target = (random >> 1) % count; target > 0; --target) empty &= empty - 1;
+	int shift = popcount64((empty & (0 - empty)) - 1) - 3;
+	board->rows[0] |= (uint64_t)spawnExp(random) << shift;
+	return shift / 4;
+#else
+	uint64_t empty[SIZED_HEIGHT];
+	int count = 0;
+	for (int i = 0; i < SIZED_HEIGHT; ++i) {
+		empty[i] = zeroFields(board->rows[i], SIZED_LOWS, SIZED_HIGHS) & SIZED_CELLS;
+		count += popcount64(empty[i]);
+	}
+	if (count == 0) return -1;
+
+	int target = (random >> 1) % count;
+	for (int i = 0; i < SIZED_HEIGHT; ++i) {
+		int rowCount = popcount64(empty[i]);
+		if (target >= rowCount) {
+			target -= rowCount;
+			continue;
+		}
+		uint64_t mask = empty[i];
+		for (; target > 0; --target) mask &= mask - 1;
+		int shift = popcount64((mask & (0 - mask)) - 1) - 7;
+		board->rows[i] |= (uint64_t)spawnExp(random) << shift;
+		return i * SIZED_WIDTH + shift / 8;
+	}
+	return -1;
+#endif
+}
+
+// Same choice as policyGreedy: the most merge points, then the most empty cells.
+SIZED_INLINE int SZ(greedyMove)(const SizedBoard *board, int legal) {
+	int best = -1;
+	int64_t bestScore = -1;
+	int bestEmpty = -1;
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		if (!((legal >> dir) & 1)) continue;
+		SizedBoard moved = *board;
+		int64_t score = 0;
+		SZ(move)(&moved, (Direction)dir, &score);
+
+		int empty = SZ(emptyCount)(&moved);
+		if (score > bestScore || (score == bestScore && empty > bestEmpty)) {
+			best = dir;
+			bestScore = score;
+			bestEmpty = empty;
+		}
+	}
+	return best;
+}
+
+SIZED_INLINE void SZ(play)(Rng *rng, SizedResult *result, bool greedy) {
+	SizedBoard board = {{0}};
+	result->moves = 0;
+	result->score = 0;
+	SZ(spawn)(&board, (uint32_t)rngNext(rng));
+	SZ(spawn)(&board, (uint32_t)rngNext(rng));
+
+	for (int legal; (legal = SZ(legalMoves)(&board)) != 0;) {
+		int dir = 0;
+		if (greedy) {
+			dir = SZ(greedyMove)(&board, legal);
+		} else {
+			int count = (legal & 1) + ((legal >> 1) & 1) + ((legal >> 2) & 1) + ((legal >> 3) & 1);
+			int pick = rngBelow(rng, count);
+			while (!((legal >> dir) & 1) || pick-- != 0) ++dir;
+		}
+
+		SZ(move)(&board, (Direction)dir, &result->score);
+		SZ(spawn)(&board, (uint32_t)rngNext(rng));
+		result->moves++;
+	}
+
+	result->maxExp = 0;
+	for (int i = 0; i < SIZED_HEIGHT; ++i) {
+		for (int j = 0; j < SIZED_WIDTH; ++j) {
+			int exp = SZ(getExp)(&board, i, j);
+			if (exp > result->maxExp) result->maxExp = exp;
+		}
+	}
+}
+
+static void SZ(playRandom)(Rng *rng, SizedResult *result) {
+	SZ(play)(rng, result, false);
+}
+
+static void SZ(playGreedy)(Rng *rng, SizedResult *result) {
+	SZ(play)(rng, result, true);
+}
+
+#undef SIZED_LEFT_TABLE
+#undef SIZED_SCORE_TABLE
+#undef SIZED_ROW_BITS
+#undef SIZED_MAX_EXP
+#undef SIZED_LOWS
+#undef SIZED_HIGHS
+#undef SIZED_CAPPED
+#undef SIZED_CELLS
+#undef SIZED_PAIRS_H
+#undef SIZED_PAIRS_V
+#undef SIZED_PACKED
+#undef SIZED_WIDTH
+#undef SIZED_HEIGHT
+#undef SIZED_NIBBLES
@@ -1,9 +1,17 @@
 #include "include/raylib.h"
 #include "include/raymath.h"
+#include "engine/ai.h"
+#include "engine/game.h"
+#include "engine/ntuple.h"
+#include "engine/platform.h"
+#include "engine/profile.h"
+#include "engine/reference.h"
+#include "engine/replay.h"
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #define debug false
@@ -17,13 +25,23 @@
 #define BTN_DOWN_SCALE (0.85f)
 #define BTN_HOVER_LIGHTEN (0.15f)
 
-#define BWIDTH 4
-#define BHEIGHT 4
-#define MAX_MERGES (BHEIGHT * BWIDTH / 2)
+// Durations in seconds
+#define SLIDE_TIME (1.0f / 6)
+#define SPAWN_TIME (1.0f / 6)
+#define MERGE_TIME (0.12f)
+#define MERGE_POP (0.12f)
+// Slides touch at most one tile per cell; merges and spawns only start once slides end
+#define MAX_ANIMS (BWIDTH * BHEIGHT)
 
-#define ANIMDT (0.1f)
+#define INPUT_QUEUE_SIZE 8
 
-#define SCORE_MULT 2
+// Labels are baked for exponents 1 to LABEL_COUNT, i.e. tiles 2 to 32768, the
+// largest a 4-bit packed cell holds
+#define LABEL_COUNT 15
+#define LABEL_COLUMNS 6
+
+// Written on exit if the profiler overlay was opened during the session
+#define TRACE_PATH "trace.json"
 
 typedef enum GameState {
 	TITLESCREEN,
@@ -31,28 +49,77 @@ typedef enum GameState {
 	GAMEOVER
 } GameState;
 
-typedef struct Pos {
-	int x;
-	int y;
-} Pos;
-
-typedef struct Anim {
-	int dx;
-	int dy;
-	float t;
-} Anim;
+// Which bot picks moves while autoplay is on.
+typedef enum Autoplay {
+	AUTOPLAY_OFF,
+	AUTOPLAY_SEARCH,
+	AUTOPLAY_NTUPLE
+} Autoplay;
+
+typedef enum AnimKind {
+	ANIM_SLIDE,
+	ANIM_MERGE,
+	ANIM_SPAWN
+} AnimKind;
+
+// Live animations are entries [0, count) of each array. Cells are i * BWIDTH + j.
+typedef struct AnimTable {
+	int count;
+	int num[MAX_ANIMS];
+	unsigned char fromCell[MAX_ANIMS];
+	unsigned char toCell[MAX_ANIMS];
+	unsigned char kind[MAX_ANIMS];
+	float start[MAX_ANIMS];
+	float duration[MAX_ANIMS];
+} AnimTable;
 
 typedef struct Tile {
 	int num;
-	Anim *anim;
 } Tile;
 
+typedef struct BoardLayout {
+	Vector2 pos;
+	float dim;
+	float thick;
+	float innerDim;
+} BoardLayout;
+
+// Every tile label pre-rendered at its fitted size, one square slot per exponent
+typedef struct LabelAtlas {
+	RenderTexture2D target;
+	int slot;
+} LabelAtlas;
+
+// Moves waiting to be applied, oldest at head
+typedef struct InputQueue {
+	Direction moves[INPUT_QUEUE_SIZE];
+	int head;
+	int count;
+} InputQueue;
+
+typedef struct TileSprite {
+	int num;
+	float x;
+	float y;
+	float size;
+	bool showText;
+} TileSprite;
+
 typedef struct BoardState {
-	int score;
+	Game game;
+	uint64_t seed;
+	int gamesStarted;
 	Tile board[BHEIGHT][BWIDTH];
-	int newState[BHEIGHT][BWIDTH];
-	int animCount;
+	int legalMoves;
+	AnimTable anims;
+	float clock;
+	uint16_t mergedCells;
+	int spawnCell;
 	bool spawningTiles;
+	InputQueue inputs;
+	ReplayWriter *recorder; // NULL unless games are being recorded
+	const ReplayGame *playback; // NULL unless a recorded game is being shown
+	uint32_t playbackMove;
 } BoardState;
 
 typedef struct Button {
@@ -67,16 +134,31 @@ typedef struct Button {
 
 void restartGame(BoardState *state, GameState *gameState);
 int generateTile(BoardState *state);
-bool isFullBoard(Tile board[BHEIGHT][BWIDTH]);
+void moveTiles(BoardState *state, Direction dir);
+void syncTiles(BoardState *state);
+void showSpawnedTiles(BoardState *state);
+bool pushInput(InputQueue *queue, Direction dir);
+bool popInput(InputQueue *queue, Direction *dir);
+void addAnim(BoardState *state, AnimKind kind, int num, int fromCell, int toCell, float duration);
+void resetAnims(BoardState *state);
 void endAnims(BoardState *state);
-void updateAnims(Tile tiles[BHEIGHT][BWIDTH], int *animCount);
+void updateAnims(BoardState *state, float dt);
+int collectSprites(const BoardState *state, TileSprite *sprites);
+BoardLayout computeLayout(Vector2 screenSize);
+// Centres a button horizontally, offsetY below the middle of the screen.
+Rectangle buttonRect(Vector2 screenSize, float offsetY);
+RenderTexture2D bakeBoard(BoardLayout layout);
+void drawBaked(RenderTexture2D target, Vector2 pos);
+LabelAtlas bakeLabels(Font font, BoardLayout layout);
+void drawLabel(const LabelAtlas *atlas, int exp, Rectangle dest);
 Color lightenColor(Color color, float amount);
-void drawButton(Button btn, Font font);
+// Returns the number of draw calls it made, for the profiler.
+int drawButton(Button btn, Font font);
 void drawCenteredText(const char *text, Rectangle parent, float fontSize, Font font, Color color, float spacing);
 void handleButtons(Button* buttons, int btnCount, BoardState *state, GameState *gameState);
 
 #if debug
-bool runTests(Tile tiles[BHEIGHT][BWIDTH], int newState[BHEIGHT][BWIDTH], int *animCount, bool *spawningTiles);
+bool runTests(Board prevBoard, int prevScore, Direction dir, const BoardState *state);
 void printBoard(Tile tiles[BHEIGHT][BWIDTH]);
 void printTiles(Tile tiles[BHEIGHT][BWIDTH]);
 void printState(int board[BHEIGHT][BWIDTH]);
@@ -84,20 +166,37 @@ int getBoardCount(int tiles[BHEIGHT][BWIDTH]);
 void doNothing(BoardState *state, GameState *gameState);
 #endif
 
-int main(void) {
-	const Vector2 screenSize = {1280, 720};
+int main(int argc, char **argv) {
+	Vector2 screenSize = {1280, 720};
 	const char *screenName = "2048";
 	const int targetFPS = 60;
 
 	GameState gameState = TITLESCREEN;
 
+	SetConfigFlags(FLAG_WINDOW_RESIZABLE);
 	InitWindow(screenSize.x, screenSize.y, screenName);
+	SetWindowMinSize(640, 480);
 	SetTargetFPS(targetFPS);
+	boardInit();
 
 	Font numFont = LoadFontEx("res/AzeretMono-Bold.ttf", TEXT_L, 0, 250);
 	Image icon = LoadImage("res/2048logo.png");
 	SetWindowIcon(icon);
 
+	BoardLayout layout = computeLayout(screenSize);
+	RenderTexture2D boardLayer = bakeBoard(layout);
+	LabelAtlas labels = bakeLabels(numFont, layout);
+
+	// F3 toggles the frame time overlay; opening it also turns on the trace dump
+	Profiler profiler;
+	profileInit(&profiler);
+	bool showProfiler = false;
+	bool writeTrace = false;
+
+	// While nothing is animating, EndDrawing sleeps until the next input event
+	// instead of redrawing an unchanged frame 60 times a second
+	bool waitingForEvents = false;
+
 	Color numColors[] = {
 		(Color){245, 203, 192, 255},
 		(Color){240, 152, 129, 255},
@@ -117,12 +216,53 @@ int main(void) {
 		(Color){26, 26, 26, 255}
 	};
 
-	BoardState state;
+	// Passing a seed on the command line replays the same sequence of spawns.
+	// --record appends every game played to a replay file, --replay shows the
+	// first game of one and --weights loads a network for n-tuple autoplay.
+	BoardState state = {0};
+	state.seed = (uint64_t)time(NULL);
+
+	const char *recordPath = NULL;
+	const char *replayPath = NULL;
+	const char *weightsPath = NULL;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			recordPath = argv[++i];
+		} else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			replayPath = argv[++i];
+		} else if (strcmp(argv[i], "--weights") == 0 && i + 1 < argc) {
+			weightsPath = argv[++i];
+		} else {
+			state.seed = strtoull(argv[i], NULL, 10);
+		}
+	}
+
+	ReplayWriter recorder;
+	if (recordPath != NULL) {
+		if (replayWriterOpen(&recorder, recordPath)) state.recorder = &recorder;
+		else printf("ERROR: could not create %s\n", recordPath);
+	}
+	ReplayReader player;
+	if (replayPath != NULL) {
+		if (replayReaderOpen(&player, replayPath) && replayRead(&player) == REPLAY_OK) state.playback = &player.game;
+		else printf("ERROR: could not read a game from %s\n", replayPath);
+	}
+
+	Ai ai;
+	bool aiReady = aiInit(&ai);
+	ai.threads = cpuCount();
+	NTupleNet net = {{NULL}};
+	bool netReady = false;
+	if (weightsPath != NULL) {
+		netReady = ntupleMap(&net, weightsPath);
+		if (!netReady) printf("ERROR: could not load a network from %s\n", weightsPath);
+	}
+	Autoplay autoplay = AUTOPLAY_OFF;
 
 #define TS_BTN_COUNT 1
 	Button titleScreenButtons[TS_BTN_COUNT] = {
 		(Button){
-			(Rectangle){screenSize.x / 2 - 150, screenSize.y / 2 - 80, 300, 80},
+			buttonRect(screenSize, -80),
 			0.2,
 			GRAY,
 			"Start",
@@ -135,7 +275,7 @@ int main(void) {
 #define GO_BTN_COUNT 1
 	Button gameOverButtons[GO_BTN_COUNT] = {
 		(Button){
-			(Rectangle){screenSize.x / 2 - 150, screenSize.y / 2 + 40, 300, 80},
+			buttonRect(screenSize, 40),
 			0.2,
 			GRAY,
 			"Restart",
@@ -146,605 +286,569 @@ int main(void) {
 	};
 
 	while (!WindowShouldClose()) {
+		// Everything is laid out for the window's size, and the board and its
+		// labels are baked at it, so a resize redoes both
+		if (IsWindowResized()) {
+			screenSize = (Vector2){GetScreenWidth(), GetScreenHeight()};
+			layout = computeLayout(screenSize);
+			UnloadRenderTexture(boardLayer);
+			UnloadRenderTexture(labels.target);
+			boardLayer = bakeBoard(layout);
+			labels = bakeLabels(numFont, layout);
+			titleScreenButtons[0].rect = buttonRect(screenSize, -80);
+			gameOverButtons[0].rect = buttonRect(screenSize, 40);
+		}
+		profileFrameBegin(&profiler);
+		if (IsKeyPressed(KEY_F3)) {
+			showProfiler = !showProfiler;
+			writeTrace = true;
+		}
+		// raylib times a frame before waiting for events, so the frame after
+		// waking up reports the whole idle period; clamp it so animations
+		// started on the wake frame still play out
+		float dt = fminf(GetFrameTime(), 2.0f / targetFPS);
+		int64_t scope;
+
 		switch (gameState) {
 
 		case TITLESCREEN:
+			scope = profileBegin(&profiler, "input");
 			handleButtons(titleScreenButtons, TS_BTN_COUNT, &state, &gameState);
+			profileEnd(&profiler, scope);
 			break;
 
 		case GAMEPLAY:
-			if (isFullBoard(state.board) && state.animCount == 0) gameState = GAMEOVER;
-
-			int input = GetKeyPressed();
-			#if debug
-			if (input == KEY_SPACE) {
-				printBoard(state.board);
-			}
-			if (input == KEY_B) {
-				printTiles(state.board);
-			}
-			if (input == KEY_R) {
-				restartGame(&state, &gameState);
-				printf("Restarted game\n");
+			if (state.anims.count == 0 && !state.spawningTiles && state.legalMoves == 0) {
+				gameState = GAMEOVER;
+				if (state.recorder != NULL) replayEnd(state.recorder, state.game.score);
 			}
-			if (input == KEY_I) {
-				printf("Active anims: %d, shouldSpawnTile: %s\n", state.animCount, state.spawningTiles ? "true" : "false");
-				if (state.animCount > 0) {
-					for (int i = 0; i < BHEIGHT; ++i) {
-						for (int j = 0; j < BWIDTH; ++j) {
-							Anim *a = state.board[i][j].anim;
-							if (a == NULL) printf("Anim at (%d, %d) is null\n", j, i);
-							else printf("Anim at (%d, %d) has dx: %d, dy: %d, t: %f\n", j, i, a->dx, a->dy, a->t);
-						}
-					}
+
+			scope = profileBegin(&profiler, "input");
+
+			// Arrow keys are ignored while a recorded game plays back, since a
+			// move of the user's would take the board off the record
+			bool replaying = state.playback != NULL && state.playbackMove < state.playback->moveCount;
+
+			// Buffer every key pressed this frame so none are lost to running animations
+			for (int input = GetKeyPressed(); input != 0; input = GetKeyPressed()) {
+				#if debug
+				if (input == KEY_SPACE) {
+					printBoard(state.board);
 				}
-			}
-			int prevState[BHEIGHT][BWIDTH];
-			for (int i = 0; i < BHEIGHT; ++i) {
-				for (int j = 0; j < BWIDTH; ++j) {
-					prevState[i][j] = state.board[i][j].num;
+				if (input == KEY_B) {
+					printTiles(state.board);
 				}
-			}
-			#endif
-			switch (input) {
-				case KEY_UP: {
-					endAnims(&state);
-					if (state.animCount > 0) break;
-
-					Pos mergings[MAX_MERGES];
-					for (int i = 0; i < MAX_MERGES; ++i) {
-						mergings[i] = (Pos){-1, -1};
-					}
-					int mergeCount = 0;
-
-					for (int i = 1; i < BHEIGHT; ++i) {
-						for (int j = 0; j < BWIDTH; ++j) {
-							int value = state.board[i][j].num;
-
-							if (value == 0) continue;
-
-							int delta = 0;
-							bool willCombine = false;
-							int nextNum = 0;
-							int mergeTilesSeen = 0;
-
-							for (int k = i-1; k >= 0; k--) {
-								int collidedValue = state.board[k][j].num;
-								bool mergeAhead = false;
-
-								if (collidedValue == 0) {
-									delta++;
-									continue;
-								} 
-
-								if (nextNum == 0) {
-									nextNum = collidedValue;
-								} else {
-									nextNum = -1;
-								}
-
-
-								for (int s = 0; s < mergeCount; ++s) {
-									if (mergings[s].x == j && mergings[s].y == k) {
-										mergeAhead = true;
-										mergeTilesSeen++;
-										break;
-									}
-								}
-
-								if (mergeAhead) {
-									if (mergeTilesSeen % 2 == 1) delta++;
-									continue;
-								}
-
-								if (nextNum == value && willCombine == false) {
-									delta++;
-									willCombine = true;
-									mergings[mergeCount] = (Pos){j, k};
-									mergeCount++;
-									mergings[mergeCount] = (Pos){j, i};
-									mergeCount++;
-								}
-							}
-
-							if (delta > 0) {
-								state.newState[i][j] = 0;
-								state.newState[i - delta][j] = willCombine ? value + value : value;
-								if (willCombine) state.score += value * SCORE_MULT;
-
-								Anim *newAnim = malloc(sizeof(Anim));
-								newAnim->dx = 0;
-								newAnim->dy = -delta;
-								newAnim->t = 1;
-
-								state.board[i][j].anim = newAnim;
-								state.animCount++;
-
-								state.spawningTiles = true;
-							}
-						}
-					}
-					break;
+				if (input == KEY_R) {
+					restartGame(&state, &gameState);
+					printf("Restarted game\n");
 				}
-				case KEY_DOWN: {
-					endAnims(&state);
-					if (state.animCount > 0) break;
-
-					Pos mergings[MAX_MERGES];
-					for (int i = 0; i < MAX_MERGES; ++i) {
-						mergings[i] = (Pos){-1, -1};
-					}
-					int mergeCount = 0;
-
-					for (int i = 2; i >= 0; --i) {
-						for (int j = 0; j < 4; ++j) {
-							int value = state.board[i][j].num;
-
-							if (value == 0) continue;
-
-							int delta = 0;
-							bool willCombine = false;
-							int nextNum = 0;
-							int mergeTilesSeen = 0;
-
-							for (int k = i+1; k <= 3; ++k) {
-								int collidedValue = state.board[k][j].num;
-								bool mergeAhead = false;
-
-								if (collidedValue == 0) {
-									delta++;
-									continue;
-								} 
-
-								if (nextNum == 0) {
-									nextNum = collidedValue;
-								} else {
-									nextNum = -1;
-								}
-
-								for (int s = 0; s < mergeCount; ++s) {
-									if (mergings[s].x == j && mergings[s].y == k) {
-										mergeAhead = true;
-										mergeTilesSeen++;
-										break;
-									}
-								}
-
-								if (mergeAhead) {
-									if (mergeTilesSeen % 2 == 1) delta++;
-									continue;
-								}
-
-								if (nextNum == value && willCombine == false) {
-									delta++;
-									willCombine = true;
-									mergings[mergeCount] = (Pos){j, k};
-									mergeCount++;
-									mergings[mergeCount] = (Pos){j, i};
-									mergeCount++;
-								}
-							}
-
-							if (delta > 0) {
-								state.newState[i][j] = 0;
-								state.newState[i + delta][j] = willCombine ? value + value : value;
-								if (willCombine) state.score += value * SCORE_MULT;
-
-								Anim *newAnim = malloc(sizeof(Anim));
-								newAnim->dx = 0;
-								newAnim->dy = delta;
-								newAnim->t = 1;
-
-								state.board[i][j].anim = newAnim;
-								state.animCount++;
-
-								state.spawningTiles = true;
-							}
-						}
+				if (input == KEY_I) {
+					printf("Active anims: %d, shouldSpawnTile: %s, queued moves: %d\n",
+						state.anims.count, state.spawningTiles ? "true" : "false", state.inputs.count);
+					for (int a = 0; a < state.anims.count; ++a) {
+						printf("Anim %d kind %d num %d from %d to %d, start: %f, duration: %f\n",
+							a, state.anims.kind[a], state.anims.num[a], state.anims.fromCell[a], state.anims.toCell[a],
+							state.anims.start[a], state.anims.duration[a]);
 					}
-					break;
 				}
-				case KEY_LEFT: {
-					endAnims(&state);
-					if (state.animCount > 0) break;
-
-					Pos mergings[MAX_MERGES];
-					for (int i = 0; i < MAX_MERGES; ++i) {
-						mergings[i] = (Pos){-1, -1};
-					}
-					int mergeCount = 0;
-
-					for (int j = 1; j < 4; ++j) {
-						for (int i = 0; i < 4; ++i) {
-							int value = state.board[i][j].num;
-
-							if (value == 0) continue;
-
-							int delta = 0;
-							bool willCombine = false;
-							int nextNum = 0;
-							int mergeTilesSeen = 0;
-
-							for (int k = j-1; k >= 0; k--) {
-								int collidedValue = state.board[i][k].num;
-								bool mergeAhead = false;
-
-								if (collidedValue == 0) {
-									delta++;
-									continue;
-								} 
-
-								if (nextNum == 0 ) {
-									nextNum = collidedValue;
-								} else {
-									nextNum = -1;
-								}
-
-
-								for (int s = 0; s < mergeCount; ++s) {
-									if (mergings[s].x == k && mergings[s].y == i) {
-										mergeAhead = true;
-										mergeTilesSeen++;
-										break;
-									}
-								}
-
-								if (mergeAhead) {
-									if (mergeTilesSeen % 2 == 1) delta++;
-									continue;
-								}
-
-								if (nextNum == value && willCombine == false) {
-									delta++;
-									willCombine = true;
-									mergings[mergeCount] = (Pos){k, i};
-									mergeCount++;
-									mergings[mergeCount] = (Pos){j, i};
-									mergeCount++;
-								}
-							}
-
-							if (delta > 0) {
-								state.newState[i][j] = 0;
-								state.newState[i][j - delta] = willCombine ? value + value : value;
-								if (willCombine) state.score += value * SCORE_MULT;
-
-								Anim *newAnim = malloc(sizeof(Anim));
-								newAnim->dx = -delta;
-								newAnim->dy = 0;
-								newAnim->t = 1;
-
-								state.board[i][j].anim = newAnim;
-								state.animCount++;
-
-								state.spawningTiles = true;
-							}
-						}
-					}
-					break;
+				#endif
+				if (replaying && (input == KEY_UP || input == KEY_DOWN || input == KEY_LEFT || input == KEY_RIGHT)) continue;
+				switch (input) {
+					case KEY_UP: pushInput(&state.inputs, MOVE_UP); break;
+					case KEY_DOWN: pushInput(&state.inputs, MOVE_DOWN); break;
+					case KEY_LEFT: pushInput(&state.inputs, MOVE_LEFT); break;
+					case KEY_RIGHT: pushInput(&state.inputs, MOVE_RIGHT); break;
+					case KEY_A: autoplay = aiReady && autoplay != AUTOPLAY_SEARCH ? AUTOPLAY_SEARCH : AUTOPLAY_OFF; break;
+					case KEY_N: autoplay = netReady && autoplay != AUTOPLAY_NTUPLE ? AUTOPLAY_NTUPLE : AUTOPLAY_OFF; break;
 				}
-				case KEY_RIGHT: {
-					endAnims(&state);
-					if (state.animCount > 0) break;
+			}
+			profileEnd(&profiler, scope);
+
+			if (replaying && state.inputs.count == 0 && state.anims.count == 0) {
+				pushInput(&state.inputs, replayGetMove(state.playback, state.playbackMove++));
+			} else if (autoplay != AUTOPLAY_OFF && state.inputs.count == 0 && state.anims.count == 0 && state.legalMoves != 0) {
+				scope = profileBegin(&profiler, "ai");
+				pushInput(&state.inputs, autoplay == AUTOPLAY_NTUPLE
+					? ntupleBestMove(&net, state.game.board)
+					: aiBestMove(&ai, state.game.board));
+				profileEnd(&profiler, scope);
+			}
 
-					Pos mergings[MAX_MERGES];
-					for (int i = 0; i < MAX_MERGES; ++i) {
-						mergings[i] = (Pos){-1, -1};
-					}
-					int mergeCount = 0;
-
-					for (int j = 2; j >= 0; --j) {
-						for (int i = 0; i < 4; ++i) {
-							int value = state.board[i][j].num;
-
-							if (value == 0) continue;
-
-							int delta = 0;
-							bool willCombine = false;
-							int nextNum = 0;
-							int mergeTilesSeen = 0;
-
-							for (int k = j+1; k <= 3; ++k) {
-								int collidedValue = state.board[i][k].num;
-								bool mergeAhead = false;
-
-								if (collidedValue == 0) {
-									delta++;
-									continue;
-								} 
-
-								if (nextNum == 0) {
-									nextNum = collidedValue;
-								} else {
-									nextNum = -1;
-								}
-
-
-								for (int s = 0; s < mergeCount; ++s) {
-									if (mergings[s].x == k && mergings[s].y == i) {
-										mergeAhead = true;
-										mergeTilesSeen++;
-										break;
-									}
-								}
-
-								if (mergeAhead) {
-									if (mergeTilesSeen % 2 == 1) delta++;
-									continue;
-								}
-
-								if (nextNum == value && willCombine == false) {
-									delta++;
-									willCombine = true;
-									mergings[mergeCount] = (Pos){k, i};
-									mergeCount++;
-									mergings[mergeCount] = (Pos){j, i};
-									mergeCount++;
-								}
-							}
-
-							if (delta > 0) {
-								state.newState[i][j] = 0;
-								state.newState[i][j + delta] = willCombine ? value + value : value;
-								if (willCombine) state.score += value * SCORE_MULT;
-
-								Anim *newAnim = malloc(sizeof(Anim));
-								newAnim->dx = delta;
-								newAnim->dy = 0;
-								newAnim->t = 1;
-
-								state.board[i][j].anim = newAnim;
-								state.animCount++;
-
-								state.spawningTiles = true;
-							}
-						}
-					}
-					break;
+			// One queued move per frame. The logical board is always up to date,
+			// so a move during an animation just skips the animation to its end.
+			// Blocked directions are dropped without touching the animations.
+			Direction moveDir;
+			if (state.legalMoves == 0) {
+				state.inputs.count = 0;
+			} else if (popInput(&state.inputs, &moveDir) && (state.legalMoves & (1 << moveDir))) {
+				scope = profileBegin(&profiler, "move");
+				endAnims(&state);
+				#if debug
+				Board prevBoard = state.game.board;
+				int prevScore = state.game.score;
+				#endif
+				moveTiles(&state, moveDir);
+				profileEnd(&profiler, scope);
+				#if debug
+				if (!runTests(prevBoard, prevScore, moveDir, &state)) {
+					printf("ERROR: move does not match the reference\n");
 				}
+				#endif
 			}
 
-			updateAnims(state.board, &(state.animCount));
-
-			if (state.animCount == 0) {
-				for (int i = 0; i < BHEIGHT; ++i) {
-					for (int j = 0; j < BWIDTH; ++j) {
-						state.board[i][j].num = state.newState[i][j];
-					}
-				}
+			scope = profileBegin(&profiler, "updateAnims");
+			updateAnims(&state, dt);
 
-				if (state.spawningTiles) {
-					generateTile(&state);
-				}
+			if (state.anims.count == 0) {
+				syncTiles(&state);
+				if (state.spawningTiles) showSpawnedTiles(&state);
 			}
+			profileEnd(&profiler, scope);
 			break;
 
 		case GAMEOVER:
+			scope = profileBegin(&profiler, "input");
 			handleButtons(gameOverButtons, GO_BTN_COUNT, &state, &gameState);
+			profileEnd(&profiler, scope);
 			break;
 
 		default: printf("ERROR: invalid game state\n");
 		}
 
+		bool idle = gameState != GAMEPLAY
+			|| (autoplay == AUTOPLAY_OFF && state.anims.count == 0 && !state.spawningTiles
+				&& (state.playback == NULL || state.playbackMove == state.playback->moveCount)
+				&& state.inputs.count == 0 && state.legalMoves != 0);
+		if (idle != waitingForEvents) {
+			if (idle) EnableEventWaiting();
+			else DisableEventWaiting();
+			waitingForEvents = idle;
+		}
+
 		BeginDrawing();
 			if (gameState == TITLESCREEN) {
+				scope = profileBegin(&profiler, "drawText");
 				ClearBackground(CRIMSON);
 				Rectangle titleParent = (Rectangle){0, 0, screenSize.x, screenSize.y / 3};
 				drawCenteredText("2048", titleParent, 200, numFont, WHITE, 2);
 				Rectangle creatorNameParent = (Rectangle){0, screenSize.y * 9/10, screenSize.x, screenSize.y / 10};
 				drawCenteredText("made by Ethan Carter", creatorNameParent, TEXT_S, numFont, WHITE, 0);
+				profileDraws(&profiler, 2);
 
 				for (int i = 0; i < TS_BTN_COUNT; ++i) {
-					drawButton(titleScreenButtons[i], numFont);
+					profileDraws(&profiler, drawButton(titleScreenButtons[i], numFont));
 				}
+				profileEnd(&profiler, scope);
 			} else if (gameState == GAMEPLAY || gameState == GAMEOVER) {
+				scope = profileBegin(&profiler, "drawBoard");
 				ClearBackground(RAYWHITE);
 				//Draw Board background
-				float boardDim = fminf(screenSize.x*0.8f, screenSize.y*0.8f);
-				Vector2 boardPos = (Vector2){screenSize.x / 2 - boardDim / 2, screenSize.y - boardDim - 20};
-				DrawRectangleRounded((Rectangle){boardPos.x, boardPos.y, boardDim, boardDim}, 0.05f, 0, BROWN);
-				float thick = 10;
-				float innerDim = (boardDim - 5 * thick) / 4;
+				Vector2 boardPos = layout.pos;
+				float thick = layout.thick;
+				float innerDim = layout.innerDim;
 				float halfDim = 0.5f * innerDim;
-
-				for (int i = 0; i < BHEIGHT; ++i) {
-					for (int j = 0; j < BWIDTH; ++j) {
-						DrawRectangleRounded(
-							(Rectangle){
-								boardPos.x + innerDim * j + 10*(j+1), 
-								boardPos.y + innerDim * i + 10*(i+1),
-								innerDim, 
-								innerDim
-							},
-							0.05f, 0, BEIGE
-						);
-					}
-				}
+				drawBaked(boardLayer, boardPos);
+				profileDraws(&profiler, 1);
 
 				// Draw tiles
-				for (int i = 0; i < BHEIGHT; ++i) {
-					for (int j = 0; j < BWIDTH; ++j) {
-						Tile tile = state.board[i][j];
-						int num = tile.num;
-
-						if (num == 0) continue;
-
-						float tileX = (tile.anim != NULL) 
-							? Lerp(j, j + tile.anim->dx, 1 - tile.anim->t)
-							: j;
-						float tileY = (tile.anim != NULL)
-							? Lerp(i, i + tile.anim->dy, 1 - tile.anim->t)
-							: i;
-						float size = 1.0f;
-						if (tile.anim != NULL) {
-							if (tile.anim->dx == 0 && tile.anim->dy == 0) {
-								size -= tile.anim->t;
-							}
-						}
-
-						DrawRectangleRounded(
-							(Rectangle){
-								boardPos.x + thick
-									+ tileX * (innerDim + thick)
-									+ (1.0f - size) * halfDim,
-								boardPos.y + thick
-									+ tileY * (innerDim + thick)
-									+ (1.0f - size) * halfDim,
-								innerDim * size, 
-								innerDim * size
-							},
-							0.05f, 0, numColors[(int)log2(num) - 1]
-						);
-
-						int textSize = TEXT_L;
-						const char *numText = TextFormat("%d", num);
-						Vector2 fontHalfDim = Vector2Scale(MeasureTextEx(numFont, numText, TEXT_L, 0), 0.5f);
-						if (fontHalfDim.x * 2 > innerDim - thick) {
-							textSize = TEXT_M;
-							fontHalfDim = Vector2Scale(MeasureTextEx(numFont, numText, TEXT_M, 0), 0.5f);
-						}
-						if (fontHalfDim.x * 2 > innerDim - thick) {
-							textSize = TEXT_S;
-							fontHalfDim = Vector2Scale(MeasureTextEx(numFont, numText, TEXT_S, 0), 0.5f);
-						}
-						if (FloatEquals(size, 1.0f)) {
-							DrawTextEx(numFont, numText, 
-								(Vector2){
-									boardPos.x + thick + halfDim - fontHalfDim.x + tileX * (innerDim + thick),
-									boardPos.y + thick + halfDim - fontHalfDim.y + tileY * (innerDim + thick),
-								},
-								textSize, 0, BLACK);
-						}
+				TileSprite sprites[BWIDTH * BHEIGHT + MAX_ANIMS];
+				int spriteCount = collectSprites(&state, sprites);
+				for (int s = 0; s < spriteCount; ++s) {
+					int exp = (int)log2(sprites[s].num);
+					float tileX = sprites[s].x;
+					float tileY = sprites[s].y;
+					float size = sprites[s].size;
+
+					Rectangle tileRect = (Rectangle){
+						boardPos.x + thick
+							+ tileX * (innerDim + thick)
+							+ (1.0f - size) * halfDim,
+						boardPos.y + thick
+							+ tileY * (innerDim + thick)
+							+ (1.0f - size) * halfDim,
+						innerDim * size, 
+						innerDim * size
+					};
+					DrawRectangleRounded(tileRect, 0.05f, 0, numColors[exp - 1]);
+					profileDraws(&profiler, 1);
+
+					if (sprites[s].showText) {
+						drawLabel(&labels, exp, tileRect);
+						profileDraws(&profiler, 1);
 					}
 				}
-				drawCenteredText(TextFormat("Score:%d", state.score), 
+				profileEnd(&profiler, scope);
+
+				scope = profileBegin(&profiler, "drawText");
+				drawCenteredText(TextFormat("Score:%d", state.game.score), 
 					 (Rectangle){0, 0, screenSize.x, boardPos.y}, 
 					 TEXT_M, numFont, BLACK, 1);
+				profileDraws(&profiler, 1);
+				if (autoplay != AUTOPLAY_OFF) {
+					DrawTextEx(numFont, autoplay == AUTOPLAY_NTUPLE ? "AUTO N-TUPLE" : "AUTO", (Vector2){20, 20}, TEXT_S, 0, BLACK);
+					profileDraws(&profiler, 1);
+				}
+				profileEnd(&profiler, scope);
 			}
 
 			if (gameState == GAMEOVER) {
+				scope = profileBegin(&profiler, "drawText");
 				DrawRectangleV(Vector2Zero(), screenSize, (Color){0, 0, 0, 100});
 
 				drawCenteredText("Game Over", 
 					 (Rectangle){0, 0, screenSize.x, screenSize.y * 9 / 20}, 
 					 200, numFont, WHITE, 0);
-				drawCenteredText(TextFormat("Your score was: %d", state.score), 
+				drawCenteredText(TextFormat("Your score was: %d", state.game.score), 
 					 (Rectangle){0, screenSize.y * 8 / 20, screenSize.x, screenSize.y * 2 / 20}, 
 					 TEXT_M, numFont, WHITE, 0);
+				profileDraws(&profiler, 3);
 				for (int i = 0; i < GO_BTN_COUNT; ++i) {
-					drawButton(gameOverButtons[i], numFont);
+					profileDraws(&profiler, drawButton(gameOverButtons[i], numFont));
 				}
+				profileEnd(&profiler, scope);
 			}
+
+			if (showProfiler) {
+				// Frame times cover update and draw submission, not the wait in EndDrawing
+				ProfileSummary summary;
+				profileSummarize(&profiler, &summary);
+				const char *lines[] = {
+					TextFormat("frame min %.2f avg %.2f p99 %.2f ms", summary.min * 1000, summary.avg * 1000, summary.p99 * 1000),
+					TextFormat("%.1f draw calls over %d frames", summary.drawCalls, summary.frames)
+				};
+				for (int i = 0; i < 2; ++i) {
+					DrawText(lines[i], screenSize.x - MeasureText(lines[i], 20) - 10, 10 + 24 * i, 20, DARKGRAY);
+				}
+			}
+			profileFrameEnd(&profiler);
+
+			scope = profileBegin(&profiler, "present");
 		EndDrawing();
+		profileEnd(&profiler, scope);
 	}
 
+	if (writeTrace && !profileWriteTrace(&profiler, TRACE_PATH)) {
+		printf("ERROR: could not write %s\n", TRACE_PATH);
+	}
+	profileFree(&profiler);
+	if (state.recorder != NULL) {
+		// Keep the game in progress too
+		if (state.recorder->recording) replayEnd(state.recorder, state.game.score);
+		if (!replayWriterClose(state.recorder)) printf("ERROR: could not write %s\n", recordPath);
+	}
+	if (replayPath != NULL) replayReaderClose(&player);
+	aiFree(&ai);
+	ntupleFree(&net);
+	UnloadRenderTexture(labels.target);
+	UnloadRenderTexture(boardLayer);
 	UnloadFont(numFont);
 	CloseWindow();
 
 	return 0;
 }
 
+// Spawns into the logical board right away; the tile appears on screen once
+// showSpawnedTiles runs after the move's slides.
 int generateTile(BoardState *state) {
-	int possibleNums[] = {2,4};
-	int newIndex;
-	do {
-		newIndex = GetRandomValue(0, 15);
-	} while (state->board[newIndex % BHEIGHT][newIndex / BWIDTH].num != 0);
-
-	int newNum = possibleNums[GetRandomValue(0,1)];
-	Anim *newAnim = malloc(sizeof(Anim));
-	newAnim->dx = 0;
-	newAnim->dy = 0;
-	newAnim->t = 1;
-	state->board[newIndex % BHEIGHT][newIndex / BWIDTH].anim = newAnim;
-	state->board[newIndex % BHEIGHT][newIndex / BWIDTH].num = newNum;
-	state->newState[newIndex % BHEIGHT][newIndex / BWIDTH] = newNum;
-	state->animCount++;
+	int cell;
+	int newNum = gameSpawn(&state->game, &cell);
+	if (newNum == 0) return 0;
 
-	state->spawningTiles = false;
+	state->spawnCell = cell;
+	state->spawningTiles = true;
+	state->legalMoves = boardLegalMoves(state->game.board);
+	if (state->recorder != NULL) replayAddSpawn(state->recorder, cell, newNum);
 
 	return newNum;
 }
 
-bool isFullBoard(Tile board[BHEIGHT][BWIDTH]) {
+void showSpawnedTiles(BoardState *state) {
+	for (int cell = 0; cell < BWIDTH * BHEIGHT; ++cell) {
+		if (!(state->mergedCells & (1 << cell))) continue;
+		addAnim(state, ANIM_MERGE, state->board[cell / BWIDTH][cell % BWIDTH].num, cell, cell, MERGE_TIME);
+	}
+	state->mergedCells = 0;
+
+	int cell = state->spawnCell;
+	int num = boardGetNum(state->game.board, cell / BWIDTH, cell % BWIDTH);
+	state->board[cell / BWIDTH][cell % BWIDTH].num = num;
+	addAnim(state, ANIM_SPAWN, num, cell, cell, SPAWN_TIME);
+	state->spawningTiles = false;
+}
+
+void syncTiles(BoardState *state) {
 	for (int i = 0; i < BHEIGHT; ++i) {
-		for (int j = i % 2; j < BWIDTH; j += 2) {
-			int num = board[i][j].num;
-			if (num == 0) return false;
-
-			if (i > 0) {
-				if (board[i-1][j].num == 0 
-					|| board[i-1][j].num == num) 
-					return false;
-			}
-			if (i < 3) {
-				if (board[i+1][j].num == 0 
-					|| board[i+1][j].num == num) 
-					return false;
-			}
-			if (j > 0) {
-				if (board[i-1][j].num == 0 
-					|| board[i][j-1].num == num) 
-					return false;
-			}
-			if (j < 3) {
-				if (board[i][j+1].num == 0 
-					|| board[i][j+1].num == num) 
-					return false;
-			}
+		for (int j = 0; j < BWIDTH; ++j) {
+			state->board[i][j].num = boardGetNum(state->game.board, i, j);
 		}
 	}
+}
+
+bool pushInput(InputQueue *queue, Direction dir) {
+	if (queue->count == INPUT_QUEUE_SIZE) return false;
+	queue->moves[(queue->head + queue->count++) % INPUT_QUEUE_SIZE] = dir;
 	return true;
 }
 
-void endAnims(BoardState *state) {
-	return;
+bool popInput(InputQueue *queue, Direction *dir) {
+	if (queue->count == 0) return false;
+	*dir = queue->moves[queue->head];
+	queue->head = (queue->head + 1) % INPUT_QUEUE_SIZE;
+	queue->count--;
+	return true;
+}
+
+void moveTiles(BoardState *state, Direction dir) {
+	const int dirX[DIR_COUNT] = {0, 0, -1, 1};
+	const int dirY[DIR_COUNT] = {-1, 1, 0, 0};
+
+	Board before = state->game.board;
+	if (!gameMove(&state->game, dir)) return;
+	if (state->recorder != NULL) replayAddMove(state->recorder, dir);
+
+	int deltas[BHEIGHT][BWIDTH];
+	boardMoveDeltas(before, dir, deltas);
+
+	// Two tiles landing on one cell merge there
+	int arrivals[BWIDTH * BHEIGHT] = {0};
 	for (int i = 0; i < BHEIGHT; ++i) {
 		for (int j = 0; j < BWIDTH; ++j) {
-			if (state->board[i][j].anim == NULL) continue;
-			state->board[i][j].num = state->newState[i][j];
-			state->board[i][j].anim->t = 0.0f;
+			int num = boardGetNum(before, i, j);
+			if (num == 0) continue;
+
+			int from = i * BWIDTH + j;
+			int to = (i + dirY[dir] * deltas[i][j]) * BWIDTH + j + dirX[dir] * deltas[i][j];
+			if (++arrivals[to] == 2) state->mergedCells |= 1 << to;
+			if (deltas[i][j] > 0) addAnim(state, ANIM_SLIDE, num, from, to, SLIDE_TIME);
 		}
 	}
 
-	updateAnims(state->board, &(state->animCount));
+	generateTile(state);
+}
+
+void addAnim(BoardState *state, AnimKind kind, int num, int fromCell, int toCell, float duration) {
+	AnimTable *anims = &state->anims;
+	if (anims->count == MAX_ANIMS) return;
+
+	int a = anims->count++;
+	anims->num[a] = num;
+	anims->fromCell[a] = fromCell;
+	anims->toCell[a] = toCell;
+	anims->kind[a] = kind;
+	anims->start[a] = state->clock;
+	anims->duration[a] = duration;
+}
+
+void resetAnims(BoardState *state) {
+	state->anims.count = 0;
+	state->mergedCells = 0;
+}
+
+// Jumps every running and pending animation to its end state.
+void endAnims(BoardState *state) {
+	state->anims.count = 0;
+	state->mergedCells = 0;
+	state->spawningTiles = false;
+	syncTiles(state);
 }
 
 void restartGame(BoardState *state, GameState *gameState) {
 	for (int i = 0; i < BHEIGHT; ++i) {
 		for (int j = 0; j < BWIDTH; ++j) {
 			state->board[i][j].num = 0;
-			state->board[i][j].anim = NULL;
-			state->newState[i][j] = 0;
 		}
 	}
 
-	state->score = 0;
-	state->animCount = 0;
+	// A replay restarts from its own seed and stream every time
+	if (state->playback != NULL) {
+		state->seed = state->playback->seed;
+		state->gamesStarted = state->playback->stream;
+		state->playbackMove = 0;
+	}
+	if (state->recorder != NULL) {
+		if (state->recorder->recording) replayEnd(state->recorder, state->game.score);
+		replayBegin(state->recorder, state->seed, state->gamesStarted, true);
+	}
+	gameReset(&state->game, state->seed, state->gamesStarted++);
+	resetAnims(state);
 	state->spawningTiles = false;
+	state->inputs.head = 0;
+	state->inputs.count = 0;
 
 	generateTile(state);
+	showSpawnedTiles(state);
 	generateTile(state);
+	showSpawnedTiles(state);
 
 	*gameState = GAMEPLAY;
 }
 
-void updateAnims(Tile tiles[BHEIGHT][BWIDTH], int *animCount) {
-	if (*animCount <= 0) return;
+void updateAnims(BoardState *state, float dt) {
+	AnimTable *anims = &state->anims;
+	state->clock += dt;
+
+	// Finished entries are replaced by the last live one
+	for (int a = 0; a < anims->count;) {
+		if (state->clock - anims->start[a] < anims->duration[a]) {
+			a++;
+			continue;
+		}
+
+		int last = --anims->count;
+		anims->num[a] = anims->num[last];
+		anims->fromCell[a] = anims->fromCell[last];
+		anims->toCell[a] = anims->toCell[last];
+		anims->kind[a] = anims->kind[last];
+		anims->start[a] = anims->start[last];
+		anims->duration[a] = anims->duration[last];
+	}
+
+	// Start times are only compared with each other, so the clock can restart
+	// whenever nothing is playing; that keeps it small enough to stay precise
+	if (anims->count == 0) state->clock = 0;
+}
+
+// Lists the tiles to draw: resting tiles first, then animated ones. Cells an
+// animation is drawing from or into are skipped in the resting pass.
+int collectSprites(const BoardState *state, TileSprite *sprites) {
+	const AnimTable *anims = &state->anims;
+	uint16_t hidden = 0;
+	for (int a = 0; a < anims->count; ++a) {
+		hidden |= 1 << anims->fromCell[a];
+	}
 
+	int count = 0;
 	for (int i = 0; i < BHEIGHT; ++i) {
 		for (int j = 0; j < BWIDTH; ++j) {
-			Anim *anim = tiles[i][j].anim;
-			if (anim == NULL) continue;
+			int num = state->board[i][j].num;
+			if (num == 0 || (hidden & (1 << (i * BWIDTH + j)))) continue;
+			sprites[count++] = (TileSprite){num, j, i, 1.0f, true};
+		}
+	}
+
+	for (int a = 0; a < anims->count; ++a) {
+		float t = Clamp((state->clock - anims->start[a]) / anims->duration[a], 0.0f, 1.0f);
+		int from = anims->fromCell[a];
+		int to = anims->toCell[a];
+		TileSprite sprite = {anims->num[a], from % BWIDTH, from / BWIDTH, 1.0f, true};
+
+		switch (anims->kind[a]) {
+			case ANIM_SLIDE:
+				sprite.x = Lerp(from % BWIDTH, to % BWIDTH, t);
+				sprite.y = Lerp(from / BWIDTH, to / BWIDTH, t);
+				break;
+			case ANIM_MERGE:
+				sprite.size = 1.0f + MERGE_POP * sinf(PI * t);
+				break;
+			case ANIM_SPAWN:
+				sprite.size = t;
+				sprite.showText = false;
+				break;
+		}
+		sprites[count++] = sprite;
+	}
+	return count;
+}
+
+Rectangle buttonRect(Vector2 screenSize, float offsetY) {
+	return (Rectangle){screenSize.x / 2 - 150, screenSize.y / 2 + offsetY, 300, 80};
+}
+
+BoardLayout computeLayout(Vector2 screenSize) {
+	BoardLayout layout;
+	layout.dim = fminf(screenSize.x*0.8f, screenSize.y*0.8f);
+	layout.pos = (Vector2){screenSize.x / 2 - layout.dim / 2, screenSize.y - layout.dim - 20};
+	layout.thick = 10;
+	// Cells stay square; the longer side of the grid decides their size
+	int cells = BWIDTH > BHEIGHT ? BWIDTH : BHEIGHT;
+	layout.innerDim = (layout.dim - (cells + 1) * layout.thick) / cells;
+	return layout;
+}
 
-			anim->t -= ANIMDT;
-			if (anim->t > 0.0f) continue;
+// The board and its empty cells never change between frames, so they are
+// drawn once into a texture the size of the board.
+RenderTexture2D bakeBoard(BoardLayout layout) {
+	int size = (int)ceilf(layout.dim);
+	RenderTexture2D target = LoadRenderTexture(size, size);
 
-			tiles[i][j].anim = NULL;
-			free(anim);
-			(*animCount)--;
+	BeginTextureMode(target);
+	ClearBackground(BLANK);
+	DrawRectangleRounded((Rectangle){0, 0, layout.dim, layout.dim}, 0.05f, 0, BROWN);
+	for (int i = 0; i < BHEIGHT; ++i) {
+		for (int j = 0; j < BWIDTH; ++j) {
+			DrawRectangleRounded(
+				(Rectangle){
+					layout.thick + j * (layout.innerDim + layout.thick),
+					layout.thick + i * (layout.innerDim + layout.thick),
+					layout.innerDim,
+					layout.innerDim
+				},
+				0.05f, 0, BEIGE
+			);
 		}
 	}
+	EndTextureMode();
+
+	return target;
+}
+
+void drawBaked(RenderTexture2D target, Vector2 pos) {
+	// Render textures are stored upside down
+	Rectangle source = {0, 0, target.texture.width, -target.texture.height};
+	DrawTextureRec(target.texture, source, pos, WHITE);
+}
+
+// Runs the text fitting once per tile value instead of every frame: each
+// label takes the largest of TEXT_L, TEXT_M and TEXT_S that fits the tile.
+LabelAtlas bakeLabels(Font font, BoardLayout layout) {
+	LabelAtlas atlas;
+	atlas.slot = (int)ceilf(layout.innerDim);
+	int rows = (LABEL_COUNT + LABEL_COLUMNS - 1) / LABEL_COLUMNS;
+	atlas.target = LoadRenderTexture(atlas.slot * LABEL_COLUMNS, atlas.slot * rows);
+	SetTextureFilter(atlas.target.texture, TEXTURE_FILTER_BILINEAR);
+
+	BeginTextureMode(atlas.target);
+	ClearBackground(BLANK);
+	for (int exp = 1; exp <= LABEL_COUNT; ++exp) {
+		int textSize = TEXT_L;
+		const char *numText = TextFormat("%d", 1 << exp);
+		Vector2 fontHalfDim = Vector2Scale(MeasureTextEx(font, numText, TEXT_L, 0), 0.5f);
+		if (fontHalfDim.x * 2 > layout.innerDim - layout.thick) {
+			textSize = TEXT_M;
+			fontHalfDim = Vector2Scale(MeasureTextEx(font, numText, TEXT_M, 0), 0.5f);
+		}
+		if (fontHalfDim.x * 2 > layout.innerDim - layout.thick) {
+			textSize = TEXT_S;
+			fontHalfDim = Vector2Scale(MeasureTextEx(font, numText, TEXT_S, 0), 0.5f);
+		}
+
+		float slotX = ((exp - 1) % LABEL_COLUMNS) * atlas.slot;
+		float slotY = ((exp - 1) / LABEL_COLUMNS) * atlas.slot;
+		DrawTextEx(font, numText,
+			(Vector2){
+				slotX + 0.5f * atlas.slot - fontHalfDim.x,
+				slotY + 0.5f * atlas.slot - fontHalfDim.y
+			},
+			textSize, 0, BLACK);
+	}
+	EndTextureMode();
+
+	return atlas;
+}
+
+void drawLabel(const LabelAtlas *atlas, int exp, Rectangle dest) {
+	if (exp < 1 || exp > LABEL_COUNT) return;
+
+	float slotX = ((exp - 1) % LABEL_COLUMNS) * atlas->slot;
+	float slotY = ((exp - 1) / LABEL_COLUMNS) * atlas->slot;
+	// Render textures are stored upside down
+	Rectangle source = {
+		slotX,
+		atlas->target.texture.height - slotY - atlas->slot,
+		atlas->slot,
+		-atlas->slot
+	};
+	DrawTexturePro(atlas->target.texture, source, dest, Vector2Zero(), 0, WHITE);
 }
 
 Color lightenColor(Color color, float amount) {
@@ -756,7 +860,7 @@ Color lightenColor(Color color, float amount) {
 	};
 }
 
-void drawButton(Button btn, Font font) {
+int drawButton(Button btn, Font font) {
 	Rectangle rec = btn.rect;
 	bool btnDown = btn.isPressed;
 	float sizeDiffMult = (1 - BTN_DOWN_SCALE) / 2;
@@ -778,6 +882,7 @@ void drawButton(Button btn, Font font) {
 	DrawRectangleRoundedLines(rec, btn.round, 0, 3, BLACK);
 	DrawRectangleRounded(rec, btn.round, 0, btn.isHovered ? lightenColor(btn.color, BTN_HOVER_LIGHTEN) : btn.color);
 	drawCenteredText(btn.text, rec, fontSize, font, WHITE, 0);
+	return 3;
 }
 
 void drawCenteredText(const char *text, Rectangle parent, float fontSize, Font font, Color color, float spacing) {
@@ -836,17 +941,31 @@ void printTiles(Tile tiles[BHEIGHT][BWIDTH]) {
 	for (int i = 0; i < BHEIGHT; ++i) {
 		for (int j = 0; j < BWIDTH; ++j) {
 			printf("num: %d ", tiles[i][j].num);
-			if (tiles[i][j].anim != NULL) {
-				Anim *a = tiles[i][j].anim;
-				printf("dx: %d, dy: %d, t: %f ", a->dx, a->dy, a->t);
-			}
 		}
 		printf("\n");
 	}
 	printf("-----------------\n");
 }
 
-bool runTests(Tile tiles[BHEIGHT][BWIDTH], int newState[BHEIGHT][BWIDTH], int *animCount, bool *spawningTiles) {
+// Replays the move with the reference code and compares it to the engine,
+// ignoring the tile spawned afterwards.
+bool runTests(Board prevBoard, int prevScore, Direction dir, const BoardState *state) {
+	int nums[BHEIGHT][BWIDTH];
+	int deltas[BHEIGHT][BWIDTH];
+	int score = prevScore;
+	boardUnpack(prevBoard, nums);
+	referenceMove(nums, dir, &score, deltas);
+
+	Board board = state->game.board;
+	if (state->spawningTiles) {
+		board = boardSetExp(board, state->spawnCell / BWIDTH, state->spawnCell % BWIDTH, 0);
+	}
+	int actual[BHEIGHT][BWIDTH];
+	boardUnpack(board, actual);
+	if (memcmp(actual, nums, sizeof(nums)) != 0 || state->game.score != score) {
+		printState(nums);
+		return false;
+	}
 	return true;
 }
 
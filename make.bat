@@ -2,5 +2,13 @@
 
 mkdir build
 pushd build
-call "C:\Program Files\Microsoft Visual Studio\2022\Community\VC\Auxiliary\Build\vcvars64.bat" && cl ..\main.c /I \include /link /out:2048.exe /SUBSYSTEM:WINDOWS /ENTRY:mainCRTStartup /MACHINE:X64 ..\lib\raylib.lib msvcrt.lib opengl32.lib kernel32.lib user32.lib gdi32.lib winmm.lib shell32.lib /NODEFAULTLIB:libcmt
+call "C:\Program Files\Microsoft Visual Studio\2022\Community\VC\Auxiliary\Build\vcvars64.bat"
+mkdir engine
+cl /c /O2 /Foengine\ ..\engine\*.c && lib /out:engine.lib engine\*.obj
+cl /O2 ..\tools\sim.c engine.lib /Fe:2048-sim.exe
+cl /O2 ..\tools\bench.c engine.lib /Fe:2048-bench.exe
+cl /O2 ..\tools\fuzz.c engine.lib /Fe:2048-fuzz.exe
+cl /O2 ..\tools\replay.c engine.lib /Fe:2048-replay.exe
+cl /O2 ..\tools\train.c engine.lib /Fe:2048-train.exe
+cl ..\main.c /I \include /link /out:2048.exe /SUBSYSTEM:WINDOWS /ENTRY:mainCRTStartup /MACHINE:X64 engine.lib ..\lib\raylib.lib msvcrt.lib opengl32.lib kernel32.lib user32.lib gdi32.lib winmm.lib shell32.lib /NODEFAULTLIB:libcmt
 popd
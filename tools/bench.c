@@ -0,0 +1,362 @@
+#include "../engine/ai.h"
+#include "../engine/ntuple.h"
+#include "../engine/platform.h"
+#include "../engine/sim.h"
+#include "../engine/sized.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_RESULTS 32
+#define SEARCH_BOARDS 32
+
+typedef struct BenchConfig {
+	uint64_t seed;
+	int corpusSize;
+	double minTime; // seconds each kernel keeps repeating for
+	int depth;
+	bool json;
+} BenchConfig;
+
+typedef struct BenchResult {
+	char name[32];
+	const char *unit;
+	double ops;
+	double seconds;
+} BenchResult;
+
+typedef struct Bench {
+	BenchConfig config;
+	Board *corpus;
+	Board *scratch;
+	int *scores;
+	BenchResult results[MAX_RESULTS];
+	int resultCount;
+	volatile uint64_t sink; // keeps the compiler from discarding kernel results
+} Bench;
+
+static const char *dirNames[DIR_COUNT] = {"up", "down", "left", "right"};
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [--seed N] [--boards N] [--min-time SECONDS] [--depth N] [--json]\n", prog);
+}
+
+static void addResult(Bench *bench, const char *name, const char *unit, double ops, double seconds) {
+	if (bench->resultCount == MAX_RESULTS) return;
+	BenchResult *result = &bench->results[bench->resultCount++];
+	snprintf(result->name, sizeof(result->name), "%s", name);
+	result->unit = unit;
+	result->ops = ops;
+	result->seconds = seconds;
+}
+
+// Boards seen during random playouts, so the corpus has the tile mix of real
+// games rather than uniformly random nibbles.
+static void buildCorpus(Bench *bench) {
+	Game game;
+	Rng rng;
+	rngSeed(&rng, bench->config.seed);
+	int count = 0;
+	for (uint64_t stream = 0; count < bench->config.corpusSize; ++stream) {
+		int cell;
+		gameReset(&game, bench->config.seed, stream);
+		gameSpawn(&game, &cell);
+		gameSpawn(&game, &cell);
+		while (!gameIsOver(&game) && count < bench->config.corpusSize) {
+			bench->corpus[count++] = game.board;
+			if (!gameMove(&game, policyRandom(game.board, &rng, NULL))) break;
+			gameSpawn(&game, &cell);
+		}
+	}
+}
+
+// Fills `filled` distinct cells with random exponents 1-11.
+static Board randomFilledBoard(Rng *rng, int filled) {
+	Board board = 0;
+	for (int placed = 0; placed < filled;) {
+		int cell = rngBelow(rng, BWIDTH * BHEIGHT);
+		if (boardGetExp(board, cell / BWIDTH, cell % BWIDTH) != 0) continue;
+		board = boardSetExp(board, cell / BWIDTH, cell % BWIDTH, 1 + rngBelow(rng, 11));
+		++placed;
+	}
+	return board;
+}
+
+static void benchMoves(Bench *bench) {
+	int n = bench->config.corpusSize;
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		char name[32];
+		snprintf(name, sizeof(name), "move/%s", dirNames[dir]);
+		int64_t ops = 0;
+		double start = timeNow(), elapsed;
+		do {
+			int score = 0;
+			for (int i = 0; i < n; ++i) {
+				bench->sink ^= boardMove(bench->corpus[i], dir, &score);
+			}
+			bench->sink += score;
+			ops += n;
+		} while ((elapsed = timeNow() - start) < bench->config.minTime);
+		addResult(bench, name, "moves", ops, elapsed);
+	}
+
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		char name[32];
+		snprintf(name, sizeof(name), "moveBatch/%s", dirNames[dir]);
+		int64_t ops = 0;
+		double start = timeNow(), elapsed;
+		do {
+			boardMoveBatch(bench->corpus, bench->scratch, bench->scores, n, dir);
+			bench->sink ^= bench->scratch[ops % n] + bench->scores[ops % n];
+			ops += n;
+		} while ((elapsed = timeNow() - start) < bench->config.minTime);
+		addResult(bench, name, "moves", ops, elapsed);
+	}
+}
+
+static void benchSpawns(Bench *bench) {
+	static const int fillLevels[] = {2, 6, 10, 14};
+	int n = bench->config.corpusSize;
+	uint32_t *randoms = malloc(n * sizeof(uint32_t));
+	if (randoms == NULL) return;
+
+	Rng rng;
+	rngSeed(&rng, bench->config.seed);
+	for (int i = 0; i < n; ++i) randoms[i] = (uint32_t)rngNext(&rng);
+
+	for (int f = 0; f < (int)(sizeof(fillLevels) / sizeof(fillLevels[0])); ++f) {
+		for (int i = 0; i < n; ++i) bench->scratch[i] = randomFilledBoard(&rng, fillLevels[f]);
+
+		char name[32];
+		snprintf(name, sizeof(name), "spawn/filled%d", fillLevels[f]);
+		int64_t ops = 0;
+		double start = timeNow(), elapsed;
+		do {
+			for (int i = 0; i < n; ++i) {
+				int cell, exp;
+				bench->sink ^= boardSpawn(bench->scratch[i], randoms[i], &cell, &exp) + cell;
+			}
+			ops += n;
+		} while ((elapsed = timeNow() - start) < bench->config.minTime);
+		addResult(bench, name, "spawns", ops, elapsed);
+	}
+
+	free(randoms);
+}
+
+static void benchGameOver(Bench *bench) {
+	int n = bench->config.corpusSize;
+	int64_t ops = 0;
+	double start = timeNow(), elapsed;
+	do {
+		for (int i = 0; i < n; ++i) {
+			bench->sink += boardIsGameOver(bench->corpus[i]);
+		}
+		ops += n;
+	} while ((elapsed = timeNow() - start) < bench->config.minTime);
+	addResult(bench, "gameOver", "checks", ops, elapsed);
+
+	ops = 0;
+	start = timeNow();
+	do {
+		for (int i = 0; i < n; ++i) {
+			bench->sink += boardLegalMoves(bench->corpus[i]);
+		}
+		ops += n;
+	} while ((elapsed = timeNow() - start) < bench->config.minTime);
+	addResult(bench, "legalMoves", "checks", ops, elapsed);
+
+	ops = 0;
+	start = timeNow();
+	do {
+		for (int i = 0; i < n; ++i) {
+			int sym;
+			bench->sink ^= boardCanonical(bench->corpus[i], &sym) + sym;
+		}
+		ops += n;
+	} while ((elapsed = timeNow() - start) < bench->config.minTime);
+	addResult(bench, "canonical", "boards", ops, elapsed);
+}
+
+static void benchPlayouts(Bench *bench) {
+	Game game;
+	int64_t games = 0, moves = 0;
+	double start = timeNow(), elapsed;
+	do {
+		simPlayGame(&game, bench->config.seed, games, policyRandom, NULL);
+		bench->sink += game.score;
+		moves += game.moveCount;
+		++games;
+	} while ((elapsed = timeNow() - start) < bench->config.minTime);
+	addResult(bench, "playout/games", "games", games, elapsed);
+	addResult(bench, "playout/moves", "moves", moves, elapsed);
+}
+
+// Random playouts on every board size the sized engines support.
+static void benchSized(Bench *bench) {
+	sizedInit();
+	for (int size = SIZED_MIN; size <= SIZED_MAX; ++size) {
+		const SizedOps *ops = sizedOps(size, size);
+		Rng rng;
+		rngSeed(&rng, bench->config.seed);
+
+		char name[32];
+		snprintf(name, sizeof(name), "sized/%dx%d", size, size);
+		int64_t moves = 0;
+		double start = timeNow(), elapsed;
+		do {
+			SizedResult result;
+			ops->playRandom(&rng, &result);
+			bench->sink += result.score;
+			moves += result.moves;
+		} while ((elapsed = timeNow() - start) < bench->config.minTime);
+		addResult(bench, name, "moves", moves, elapsed);
+	}
+}
+
+// Single-threaded so the figure tracks the search itself, not the core count.
+// The table is cleared per board so every run starts equally cold.
+static void benchSearch(Bench *bench) {
+	Ai ai;
+	if (!aiInit(&ai)) return;
+	ai.depthLimit = bench->config.depth;
+
+	int stride = bench->config.corpusSize / SEARCH_BOARDS;
+	if (stride < 1) stride = 1;
+
+	int64_t nodes = 0;
+	double elapsed = 0;
+	for (int i = 0; i < SEARCH_BOARDS && i * stride < bench->config.corpusSize; ++i) {
+		Board board = bench->corpus[i * stride];
+		if (boardIsGameOver(board)) continue;
+		memset(ai.table, 0, AI_TABLE_SIZE * sizeof(AiEntry));
+		ai.nodes = 0;
+		double start = timeNow();
+		bench->sink += aiBestMove(&ai, board);
+		elapsed += timeNow() - start;
+		nodes += ai.nodes;
+	}
+	if (nodes > 0) addResult(bench, "expectimax", "nodes", nodes, elapsed);
+
+	aiFree(&ai);
+}
+
+// Move choice by a network with random weights. A fresh zeroed network would
+// read the same few cache lines, which hides the table misses real play has.
+static void benchNTuple(Bench *bench) {
+	NTupleNet net;
+	if (!ntupleInit(&net)) return;
+	Rng rng;
+	rngSeed(&rng, bench->config.seed);
+	for (int t = 0; t < NTUPLE_COUNT; ++t) {
+		size_t size = (size_t)1 << (4 * ntupleShapes[t].cellCount);
+		for (size_t k = 0; k < size; ++k) {
+			net.weights[t][k] = (float)(rngNext(&rng) >> 40) / (1 << 24);
+		}
+	}
+
+	int n = bench->config.corpusSize;
+	int64_t ops = 0;
+	double start = timeNow(), elapsed;
+	do {
+		for (int i = 0; i < n; ++i) {
+			bench->sink += ntupleBestMove(&net, bench->corpus[i]);
+		}
+		ops += n;
+	} while ((elapsed = timeNow() - start) < bench->config.minTime);
+	addResult(bench, "ntuple", "moves", ops, elapsed);
+
+	ntupleFree(&net);
+}
+
+static void printResults(const Bench *bench) {
+	if (bench->config.json) {
+		printf("{\n  \"seed\": %llu,\n  \"boards\": %d,\n  \"results\": [\n",
+			(unsigned long long)bench->config.seed, bench->config.corpusSize);
+		for (int i = 0; i < bench->resultCount; ++i) {
+			const BenchResult *r = &bench->results[i];
+			printf("    {\"name\": \"%s\", \"unit\": \"%s\", \"ops\": %.0f, \"seconds\": %.6f, "
+				"\"perSecond\": %.1f, \"nsPerOp\": %.3f}%s\n",
+				r->name, r->unit, r->ops, r->seconds, r->ops / r->seconds,
+				r->seconds * 1e9 / r->ops, i + 1 < bench->resultCount ? "," : "");
+		}
+		printf("  ]\n}\n");
+		return;
+	}
+
+	printf("seed %llu, %d boards\n", (unsigned long long)bench->config.seed, bench->config.corpusSize);
+	for (int i = 0; i < bench->resultCount; ++i) {
+		const BenchResult *r = &bench->results[i];
+		printf("%-16s %14.0f %s/s %10.2f ns/op\n",
+			r->name, r->ops / r->seconds, r->unit, r->seconds * 1e9 / r->ops);
+	}
+}
+
+int main(int argc, char **argv) {
+	Bench bench = {
+		.config = {
+			.seed = 1,
+			.corpusSize = 1 << 16,
+			.minTime = 0.5,
+			.depth = 0,
+			.json = false
+		}
+	};
+
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		if (strcmp(arg, "--json") == 0) {
+			bench.config.json = true;
+			continue;
+		}
+
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (value == NULL) {
+			usage(argv[0]);
+			return 1;
+		}
+
+		if (strcmp(arg, "--seed") == 0) {
+			bench.config.seed = strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--boards") == 0) {
+			bench.config.corpusSize = atoi(value);
+		} else if (strcmp(arg, "--min-time") == 0) {
+			bench.config.minTime = atof(value);
+		} else if (strcmp(arg, "--depth") == 0) {
+			bench.config.depth = atoi(value);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+		i++;
+	}
+
+	if (bench.config.corpusSize < 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	bench.corpus = malloc(bench.config.corpusSize * sizeof(Board));
+	bench.scratch = malloc(bench.config.corpusSize * sizeof(Board));
+	bench.scores = malloc(bench.config.corpusSize * sizeof(int));
+	if (bench.corpus == NULL || bench.scratch == NULL || bench.scores == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	boardInit();
+	buildCorpus(&bench);
+	benchMoves(&bench);
+	benchSpawns(&bench);
+	benchGameOver(&bench);
+	benchPlayouts(&bench);
+	benchSized(&bench);
+	benchSearch(&bench);
+	benchNTuple(&bench);
+	printResults(&bench);
+
+	free(bench.corpus);
+	free(bench.scratch);
+	free(bench.scores);
+	return 0;
+}
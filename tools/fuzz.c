@@ -0,0 +1,378 @@
+// Differential check of the packed engine against the reference move code,
+// plus a check that moves commute with the board symmetries, and of every
+// sized engine against a plain line slide.
+//
+// Built normally it runs seeded random boards:
+//   2048-fuzz [--iterations N] [--seed N]
+// Built with clang -fsanitize=fuzzer -DFUZZ_LIBFUZZER it exposes a libFuzzer
+// entry point instead, reading each input as a packed board and a direction.
+#include "../engine/board.h"
+#include "../engine/reference.h"
+#include "../engine/rng.h"
+#include "../engine/sized.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZ_BATCH 256
+// The reference has no exponent cap, so boards stay below 32768 tiles
+#define FUZZ_MAX_EXP 14
+
+static const char *dirNames[DIR_COUNT] = {"up", "down", "left", "right"};
+
+static void printGrid(const char *label, int nums[BHEIGHT][BWIDTH]) {
+	fprintf(stderr, "%s:\n", label);
+	for (int i = 0; i < BHEIGHT; ++i) {
+		for (int j = 0; j < BWIDTH; ++j) {
+			fprintf(stderr, "%6d", nums[i][j]);
+		}
+		fprintf(stderr, "\n");
+	}
+}
+
+static void reportMismatch(const char *what, Board board, Direction dir) {
+	int nums[BHEIGHT][BWIDTH];
+	boardUnpack(board, nums);
+	fprintf(stderr, "mismatch in %s moving %s, board %016llx\n", what, dirNames[dir], (unsigned long long)board);
+	printGrid("board", nums);
+
+	int score = 0;
+	int deltas[BHEIGHT][BWIDTH];
+	referenceMove(nums, dir, &score, deltas);
+	printGrid("reference", nums);
+	fprintf(stderr, "reference score: %d\n", score);
+
+	score = 0;
+	boardUnpack(boardMove(board, dir, &score), nums);
+	printGrid("engine", nums);
+	fprintf(stderr, "engine score: %d\n", score);
+}
+
+// Checks boardMove, boardMoveDeltas and boardLegalMoves on one board and
+// direction. batched is the boardMoveBatch result for the same input.
+// Boards are compared as unpacked values, since packing a value that is not a
+// power of two would hide the difference.
+static bool checkMove(Board board, Direction dir, Board batched, int batchedScore) {
+	int before[BHEIGHT][BWIDTH];
+	int expected[BHEIGHT][BWIDTH];
+	boardUnpack(board, before);
+	memcpy(expected, before, sizeof(expected));
+
+	int refScore = 0;
+	int refDeltas[BHEIGHT][BWIDTH];
+	referenceMove(expected, dir, &refScore, refDeltas);
+
+	int score = 0;
+	int nums[BHEIGHT][BWIDTH];
+	boardUnpack(boardMove(board, dir, &score), nums);
+	if (memcmp(nums, expected, sizeof(nums)) != 0 || score != refScore) {
+		reportMismatch("boardMove", board, dir);
+		return false;
+	}
+	boardUnpack(batched, nums);
+	if (memcmp(nums, expected, sizeof(nums)) != 0 || batchedScore != refScore) {
+		reportMismatch("boardMoveBatch", board, dir);
+		return false;
+	}
+
+	int deltas[BHEIGHT][BWIDTH];
+	boardMoveDeltas(board, dir, deltas);
+	if (memcmp(deltas, refDeltas, sizeof(deltas)) != 0) {
+		reportMismatch("boardMoveDeltas", board, dir);
+		return false;
+	}
+
+	bool legal = (boardLegalMoves(board) >> dir) & 1;
+	if (legal != (memcmp(before, expected, sizeof(before)) != 0)) {
+		reportMismatch("boardLegalMoves", board, dir);
+		return false;
+	}
+	return true;
+}
+
+// Checks that every symmetry undoes, commutes with moves and leads to the
+// same canonical board.
+static bool checkSymmetry(Board board) {
+	Board canonical = boardCanonical(board, NULL);
+	for (int sym = 0; sym < SYM_COUNT; ++sym) {
+		Board image = boardApplySymmetry(board, sym);
+		if (boardApplySymmetry(image, boardSymmetryInverse(sym)) != board
+			|| boardCanonical(image, NULL) != canonical) {
+			fprintf(stderr, "symmetry %d breaks on board %016llx\n", sym, (unsigned long long)board);
+			return false;
+		}
+
+		for (int dir = 0; dir < DIR_COUNT; ++dir) {
+			int score = 0, imageScore = 0;
+			Board moved = boardApplySymmetry(boardMove(board, dir, &score), sym);
+			Board imageMoved = boardMove(image, boardSymmetryMove(sym, dir), &imageScore);
+			if (moved != imageMoved || score != imageScore) {
+				fprintf(stderr, "symmetry %d does not commute with moving %s, board %016llx\n",
+					sym, dirNames[dir], (unsigned long long)board);
+				return false;
+			}
+		}
+	}
+
+	int sym;
+	canonical = boardCanonical(board, &sym);
+	if (canonical != boardApplySymmetry(board, sym)) {
+		fprintf(stderr, "boardCanonical reports the wrong symmetry for board %016llx\n", (unsigned long long)board);
+		return false;
+	}
+	return true;
+}
+
+#ifdef FUZZ_LIBFUZZER
+// Lowers any nibble above FUZZ_MAX_EXP so arbitrary bytes make a valid board.
+static Board clampBoard(Board board) {
+	for (int cell = 0; cell < BWIDTH * BHEIGHT; ++cell) {
+		int exp = boardGetExp(board, cell / BWIDTH, cell % BWIDTH);
+		if (exp > FUZZ_MAX_EXP) board = boardSetExp(board, cell / BWIDTH, cell % BWIDTH, FUZZ_MAX_EXP);
+	}
+	return board;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	if (size < sizeof(Board) + 1) return 0;
+
+	Board board;
+	memcpy(&board, data, sizeof(Board));
+	board = clampBoard(board);
+	Direction dir = data[sizeof(Board)] % DIR_COUNT;
+
+	boardInit();
+	Board batched;
+	int batchedScore;
+	boardMoveBatch(&board, &batched, &batchedScore, 1, dir);
+	if (!checkMove(board, dir, batched, batchedScore) || !checkSymmetry(board)) abort();
+	return 0;
+}
+#else
+// Mixes board densities and keeps most tiles small so merges are common.
+static Board randomBoard(Rng *rng) {
+	int emptyChance = rngBelow(rng, 101);
+	int maxExp = 1 + rngBelow(rng, FUZZ_MAX_EXP);
+	Board board = 0;
+	for (int cell = 0; cell < BWIDTH * BHEIGHT; ++cell) {
+		if ((int)rngBelow(rng, 100) < emptyChance) continue;
+		board = boardSetExp(board, cell / BWIDTH, cell % BWIDTH, 1 + rngBelow(rng, maxExp));
+	}
+	return board;
+}
+
+// Slides line[0, length) towards index 0: first closes the gaps, then merges
+// each pair of equal neighbours once, leaving maxExp cells alone.
+static int64_t referenceSlide(int *line, int length, int maxExp) {
+	int count = 0;
+	for (int p = 0; p < length; ++p) {
+		if (line[p] != 0) line[count++] = line[p];
+	}
+	for (int p = count; p < length; ++p) line[p] = 0;
+
+	int64_t score = 0;
+	for (int p = 0; p + 1 < length; ++p) {
+		if (line[p] == 0 || line[p] != line[p + 1] || line[p] >= maxExp) continue;
+		score += ((int64_t)1 << line[p]) * SCORE_MULT;
+		line[p]++;
+		memmove(&line[p + 1], &line[p + 2], (length - p - 2) * sizeof(int));
+		line[length - 1] = 0;
+	}
+	return score;
+}
+
+// Moves a size x size grid in dir by sliding each row or column read from the
+// side it moves towards.
+static int64_t referenceSizedMove(int grid[SIZED_MAX][SIZED_MAX], int size, Direction dir, int maxExp) {
+	int64_t score = 0;
+	for (int k = 0; k < size; ++k) {
+		int *cells[SIZED_MAX];
+		int line[SIZED_MAX];
+		for (int p = 0; p < size; ++p) {
+			int q = dir == MOVE_UP || dir == MOVE_LEFT ? p : size - 1 - p;
+			cells[p] = dir == MOVE_UP || dir == MOVE_DOWN ? &grid[q][k] : &grid[k][q];
+			line[p] = *cells[p];
+		}
+		score += referenceSlide(line, size, maxExp);
+		for (int p = 0; p < size; ++p) *cells[p] = line[p];
+	}
+	return score;
+}
+
+static void reportSized(const char *what, const SizedOps *ops, int grid[SIZED_MAX][SIZED_MAX], int dir) {
+	fprintf(stderr, "mismatch in %dx%d %s", ops->width, ops->height, what);
+	if (dir >= 0) fprintf(stderr, " moving %s", dirNames[dir]);
+	fprintf(stderr, ", board:\n");
+	for (int i = 0; i < ops->height; ++i) {
+		for (int j = 0; j < ops->width; ++j) fprintf(stderr, "%4d", grid[i][j]);
+		fprintf(stderr, "\n");
+	}
+}
+
+static bool sameGrid(const SizedOps *ops, const SizedBoard *board, int grid[SIZED_MAX][SIZED_MAX]) {
+	for (int i = 0; i < ops->height; ++i) {
+		for (int j = 0; j < ops->width; ++j) {
+			if (ops->getExp(board, i, j) != grid[i][j]) return false;
+		}
+	}
+	return true;
+}
+
+// Checks move, legalMoves, emptyCount and spawn of one sized engine on a
+// random board, and the 4x4 engine against boardMove and boardSpawn too.
+static bool checkSized(const SizedOps *ops, Rng *rng) {
+	int size = ops->width;
+	int grid[SIZED_MAX][SIZED_MAX] = {{0}};
+	SizedBoard board = {{0}};
+	int emptyChance = rngBelow(rng, 101);
+	int maxExp = 1 + rngBelow(rng, ops->maxExp < 20 ? ops->maxExp : 20);
+	// Some boards put half their tiles at the cap and spread the rest over every
+	// exponent below it, so pairs at the cap are often the only ones
+	bool capped = rngBelow(rng, 8) == 0;
+	if (capped) maxExp = ops->maxExp - 1;
+	int empty = 0;
+	for (int i = 0; i < size; ++i) {
+		for (int j = 0; j < size; ++j) {
+			if ((int)rngBelow(rng, 100) < emptyChance) {
+				empty++;
+				continue;
+			}
+			int exp = capped && rngBelow(rng, 2) ? ops->maxExp : 1 + (int)rngBelow(rng, maxExp);
+			grid[i][j] = exp;
+			ops->setExp(&board, i, j, exp);
+		}
+	}
+	if (ops->emptyCount(&board) != empty) {
+		reportSized("emptyCount", ops, grid, -1);
+		return false;
+	}
+
+	Board packed = 0;
+	if (size == BWIDTH) {
+		for (int i = 0; i < size; ++i) {
+			for (int j = 0; j < size; ++j) packed = boardSetExp(packed, i, j, grid[i][j]);
+		}
+	}
+
+	int legal = ops->legalMoves(&board);
+	for (int dir = 0; dir < DIR_COUNT; ++dir) {
+		int expected[SIZED_MAX][SIZED_MAX];
+		memcpy(expected, grid, sizeof(expected));
+		int64_t refScore = referenceSizedMove(expected, size, dir, ops->maxExp);
+		bool refMoved = memcmp(expected, grid, sizeof(expected)) != 0;
+
+		SizedBoard moved = board;
+		int64_t score = 0;
+		bool changed = ops->move(&moved, dir, &score);
+		if (!sameGrid(ops, &moved, expected) || score != refScore || changed != refMoved) {
+			reportSized("move", ops, grid, dir);
+			return false;
+		}
+		if (((legal >> dir) & 1) != refMoved) {
+			reportSized("legalMoves", ops, grid, dir);
+			return false;
+		}
+
+		if (size == BWIDTH) {
+			int packedScore = 0;
+			if (boardMove(packed, dir, &packedScore) != moved.rows[0] || packedScore != score) {
+				reportSized("move against boardMove", ops, grid, dir);
+				return false;
+			}
+		}
+	}
+
+	uint32_t random = (uint32_t)rngNext(rng);
+	SizedBoard spawned = board;
+	int cell = ops->spawn(&spawned, random);
+	if (cell < 0) {
+		if (empty != 0 || !sameGrid(ops, &spawned, grid)) {
+			reportSized("spawn on a board with no empty cell", ops, grid, -1);
+			return false;
+		}
+	} else {
+		int i = cell / size, j = cell % size;
+		int exp = cell < size * size ? ops->getExp(&spawned, i, j) : 0;
+		// Clearing the new tile must give back the board it spawned on
+		if (exp != 0) ops->setExp(&spawned, i, j, 0);
+		if ((exp != 1 && exp != 2) || grid[i][j] != 0 || !sameGrid(ops, &spawned, grid)) {
+			reportSized("spawn", ops, grid, -1);
+			return false;
+		}
+		if (size == BWIDTH) {
+			int packedCell, packedExp;
+			boardSpawn(packed, random, &packedCell, &packedExp);
+			if (packedCell != cell || packedExp != exp) {
+				reportSized("spawn against boardSpawn", ops, grid, -1);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [--iterations N] [--seed N]\n", prog);
+}
+
+int main(int argc, char **argv) {
+	int64_t iterations = 1000000;
+	uint64_t seed = 1;
+
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (value == NULL) {
+			usage(argv[0]);
+			return 1;
+		}
+
+		if (strcmp(arg, "--iterations") == 0) {
+			iterations = strtoll(value, NULL, 10);
+		} else if (strcmp(arg, "--seed") == 0) {
+			seed = strtoull(value, NULL, 10);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+		i++;
+	}
+
+	boardInit();
+	Rng rng;
+	rngSeed(&rng, seed);
+
+	Board boards[FUZZ_BATCH];
+	Board batched[FUZZ_BATCH];
+	int scores[FUZZ_BATCH];
+	int64_t checked = 0;
+	while (checked < iterations) {
+		for (int n = 0; n < FUZZ_BATCH; ++n) {
+			boards[n] = randomBoard(&rng);
+			if (!checkSymmetry(boards[n])) return 1;
+		}
+		for (int dir = 0; dir < DIR_COUNT; ++dir) {
+			boardMoveBatch(boards, batched, scores, FUZZ_BATCH, dir);
+			for (int n = 0; n < FUZZ_BATCH; ++n) {
+				if (!checkMove(boards[n], dir, batched[n], scores[n])) return 1;
+			}
+		}
+		checked += FUZZ_BATCH;
+	}
+
+	printf("%lld boards matched the reference in every direction and symmetry\n", (long long)checked);
+
+	// Sized boards take longer to check, so each size gets a tenth as many
+	sizedInit();
+	int64_t sizedIterations = iterations / 10;
+	for (int size = SIZED_MIN; size <= SIZED_MAX; ++size) {
+		const SizedOps *ops = sizedOps(size, size);
+		for (int64_t n = 0; n < sizedIterations; ++n) {
+			if (!checkSized(ops, &rng)) return 1;
+		}
+	}
+	printf("%lld boards of each size from %dx%d to %dx%d matched the line slide\n",
+		(long long)sizedIterations, SIZED_MIN, SIZED_MIN, SIZED_MAX, SIZED_MAX);
+	return 0;
+}
+#endif
@@ -0,0 +1,158 @@
+#include "../engine/platform.h"
+#include "../engine/replay.h"
+#include "../engine/sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct PolicyEntry {
+	const char *name;
+	Policy fn;
+} PolicyEntry;
+
+static const PolicyEntry policies[] = {
+	{"random", policyRandom},
+	{"greedy", policyGreedy},
+};
+
+#define POLICY_COUNT (int)(sizeof(policies) / sizeof(policies[0]))
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s record FILE [--games N] [--seed N] [--policy random|greedy] [--spawns]\n", prog);
+	fprintf(stderr, "       %s check FILE\n", prog);
+}
+
+// Plays games like simPlayGame, logging every move and spawn. The policy gets
+// its own generator: a replay only stores moves, so spawns must depend on
+// nothing but the game's (seed, stream).
+static int recordGames(const char *path, int64_t games, uint64_t seed, Policy policy, bool storeSpawns) {
+	ReplayWriter writer;
+	if (!replayWriterOpen(&writer, path)) {
+		fprintf(stderr, "could not create %s\n", path);
+		return 1;
+	}
+
+	int64_t moves = 0;
+	double start = timeNow();
+	for (int64_t n = 0; n < games; ++n) {
+		Game game;
+		Rng policyRng;
+		int cell;
+		gameReset(&game, seed, n);
+		rngSeedStream(&policyRng, ~seed, n);
+		replayBegin(&writer, seed, n, storeSpawns);
+		for (int s = 0; s < 2; ++s) {
+			int num = gameSpawn(&game, &cell);
+			replayAddSpawn(&writer, cell, num);
+		}
+
+		while (!gameIsOver(&game)) {
+			Direction dir = policy(game.board, &policyRng, NULL);
+			if (!gameMove(&game, dir)) break;
+			replayAddMove(&writer, dir);
+			int num = gameSpawn(&game, &cell);
+			replayAddSpawn(&writer, cell, num);
+		}
+		replayEnd(&writer, game.score);
+		moves += game.moveCount;
+	}
+	double elapsed = timeNow() - start;
+
+	long size = ftell(writer.file);
+	if (!replayWriterClose(&writer)) {
+		fprintf(stderr, "error writing %s\n", path);
+		return 1;
+	}
+	printf("recorded %lld games, %lld moves in %.3fs\n", (long long)games, (long long)moves, elapsed);
+	printf("%ld bytes, %.1f bytes/game\n", size, games ? (double)size / games : 0.0);
+	return 0;
+}
+
+static int checkGames(const char *path) {
+	ReplayReader reader;
+	if (!replayReaderOpen(&reader, path)) {
+		fprintf(stderr, "%s is not a replay file\n", path);
+		return 1;
+	}
+
+	int64_t games = 0, moves = 0, failed = 0;
+	ReplayStatus status;
+	double start = timeNow();
+	while ((status = replayRead(&reader)) == REPLAY_OK) {
+		Game game;
+		if (!replayRun(&reader.game, &game)) {
+			fprintf(stderr, "game %lld (seed %llu, stream %llu) does not replay\n", (long long)games,
+				(unsigned long long)reader.game.seed, (unsigned long long)reader.game.stream);
+			++failed;
+		}
+		moves += reader.game.moveCount;
+		++games;
+	}
+	double elapsed = timeNow() - start;
+	replayReaderClose(&reader);
+
+	if (status == REPLAY_CORRUPT) {
+		fprintf(stderr, "record %lld is truncated or fails its checksum\n", (long long)games);
+	}
+	printf("replayed %lld games, %lld moves in %.3fs (%.0f moves/s)\n",
+		(long long)games, (long long)moves, elapsed, elapsed > 0 ? moves / elapsed : 0.0);
+	return failed == 0 && status == REPLAY_END ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	const char *command = argv[1];
+	const char *path = argv[2];
+	if (strcmp(command, "check") == 0 && argc == 3) {
+		boardInit();
+		return checkGames(path);
+	}
+	if (strcmp(command, "record") != 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	int64_t games = 1000;
+	uint64_t seed = 1;
+	Policy policy = policyRandom;
+	bool storeSpawns = false;
+	for (int i = 3; i < argc; ++i) {
+		const char *arg = argv[i];
+		if (strcmp(arg, "--spawns") == 0) {
+			storeSpawns = true;
+			continue;
+		}
+
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (value == NULL) {
+			usage(argv[0]);
+			return 1;
+		}
+
+		if (strcmp(arg, "--games") == 0) {
+			games = strtoll(value, NULL, 10);
+		} else if (strcmp(arg, "--seed") == 0) {
+			seed = strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--policy") == 0) {
+			policy = NULL;
+			for (int p = 0; p < POLICY_COUNT; ++p) {
+				if (strcmp(value, policies[p].name) == 0) policy = policies[p].fn;
+			}
+			if (policy == NULL) {
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+		i++;
+	}
+
+	boardInit();
+	return recordGames(path, games, seed, policy, storeSpawns);
+}
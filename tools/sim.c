@@ -0,0 +1,206 @@
+#include "../engine/ai.h"
+#include "../engine/ntuple.h"
+#include "../engine/platform.h"
+#include "../engine/sim.h"
+#include "../engine/sized.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct PolicyEntry {
+	const char *name;
+	Policy fn;
+	void *(*threadInit)(void *policyCtx);
+	void (*threadFree)(void *threadCtx);
+} PolicyEntry;
+
+static const PolicyEntry policies[] = {
+	{"random", policyRandom, NULL, NULL},
+	{"greedy", policyGreedy, NULL, NULL},
+	{"expectimax", policyExpectimax, aiThreadInit, aiThreadFree},
+	{"ntuple", policyNTuple, NULL, NULL},
+};
+
+#define POLICY_COUNT (int)(sizeof(policies) / sizeof(policies[0]))
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [--games N] [--threads N] [--seed N] [--policy", prog);
+	for (int i = 0; i < POLICY_COUNT; ++i) {
+		fprintf(stderr, "%s%s", i ? "|" : " ", policies[i].name);
+	}
+	fprintf(stderr, "]\n");
+	fprintf(stderr, "  expectimax options: [--depth N] [--search-threads N]\n");
+	fprintf(stderr, "  ntuple options: --weights FILE (written by 2048-train)\n");
+	fprintf(stderr, "  --size N plays N x N boards (%d to %d) with the random or greedy policy\n", SIZED_MIN, SIZED_MAX);
+}
+
+// Games on other board sizes, handed out SIM_CHUNK at a time from next. Game
+// n draws from stream n like simRun's games, through the sized engines.
+typedef struct SizedJob {
+	const SizedOps *ops;
+	bool greedy;
+	uint64_t seed;
+	int64_t games;
+	volatile int64_t next;
+	volatile int64_t moves;
+	volatile int64_t totalScore;
+	volatile int64_t bestScore;
+	volatile int64_t maxTile[64];
+} SizedJob;
+
+static void sizedWorker(void *arg) {
+	SizedJob *job = arg;
+	int64_t moves = 0, totalScore = 0, bestScore = 0;
+	int64_t maxTile[64] = {0};
+	for (;;) {
+		int64_t first = atomicAdd64(&job->next, SIM_CHUNK);
+		if (first >= job->games) break;
+		int64_t last = first + SIM_CHUNK < job->games ? first + SIM_CHUNK : job->games;
+
+		for (int64_t n = first; n < last; ++n) {
+			Rng rng;
+			SizedResult result;
+			rngSeedStream(&rng, job->seed, n);
+			if (job->greedy) job->ops->playGreedy(&rng, &result);
+			else job->ops->playRandom(&rng, &result);
+
+			moves += result.moves;
+			totalScore += result.score;
+			if (result.score > bestScore) bestScore = result.score;
+			maxTile[result.maxExp]++;
+		}
+	}
+
+	atomicAdd64(&job->moves, moves);
+	atomicAdd64(&job->totalScore, totalScore);
+	atomicMax64(&job->bestScore, bestScore);
+	for (int i = 0; i < 64; ++i) {
+		if (maxTile[i]) atomicAdd64(&job->maxTile[i], maxTile[i]);
+	}
+}
+
+static void printStats(int64_t games, int64_t moves, int64_t totalScore, int64_t bestScore,
+	const volatile int64_t *maxTile, int tileCount, double elapsed) {
+	printf("games: %lld\n", (long long)games);
+	printf("avg score: %.1f\n", games ? (double)totalScore / games : 0.0);
+	printf("best score: %lld\n", (long long)bestScore);
+	printf("time: %.3fs (%.0f games/s, %.0f moves/s)\n", elapsed, games / elapsed, moves / elapsed);
+	printf("max tile:\n");
+	for (int i = 0; i < tileCount; ++i) {
+		if (maxTile[i] == 0) continue;
+		printf("  %6lld: %lld (%.2f%%)\n", 1LL << i, (long long)maxTile[i], 100.0 * maxTile[i] / games);
+	}
+}
+
+int main(int argc, char **argv) {
+	Ai search = {
+		.depthLimit = 0,
+		.probCutoff = AI_PROB_CUTOFF,
+		.threads = 1
+	};
+
+	SimConfig config = {
+		.games = 10000,
+		.threads = 0,
+		.seed = 1,
+		.policy = policyRandom,
+		.policyCtx = &search
+	};
+	const char *weightsPath = NULL;
+	int size = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (value == NULL) {
+			usage(argv[0]);
+			return 1;
+		}
+
+		if (strcmp(arg, "--games") == 0) {
+			config.games = strtoll(value, NULL, 10);
+		} else if (strcmp(arg, "--threads") == 0) {
+			config.threads = atoi(value);
+		} else if (strcmp(arg, "--seed") == 0) {
+			config.seed = strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--depth") == 0) {
+			search.depthLimit = atoi(value);
+		} else if (strcmp(arg, "--search-threads") == 0) {
+			search.threads = atoi(value);
+		} else if (strcmp(arg, "--weights") == 0) {
+			weightsPath = value;
+		} else if (strcmp(arg, "--size") == 0) {
+			size = atoi(value);
+		} else if (strcmp(arg, "--policy") == 0) {
+			config.policy = NULL;
+			for (int p = 0; p < POLICY_COUNT; ++p) {
+				if (strcmp(value, policies[p].name) != 0) continue;
+				config.policy = policies[p].fn;
+				config.threadInit = policies[p].threadInit;
+				config.threadFree = policies[p].threadFree;
+			}
+			if (config.policy == NULL) {
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+		i++;
+	}
+
+	if (size != 0) {
+		sizedInit();
+		const SizedOps *ops = sizedOps(size, size);
+		if (ops == NULL || (config.policy != policyRandom && config.policy != policyGreedy)) {
+			usage(argv[0]);
+			return 1;
+		}
+
+		SizedJob job = {ops, config.policy == policyGreedy, config.seed, config.games};
+		int threads = config.threads > 0 ? config.threads : cpuCount();
+		if (threads > SIM_MAX_THREADS) threads = SIM_MAX_THREADS;
+		double start = timeNow();
+		runWorkers(threads, sizedWorker, &job, 0);
+		printStats(config.games, job.moves, job.totalScore, job.bestScore, job.maxTile, 64, timeNow() - start);
+		return 0;
+	}
+
+	// Every expectimax worker searches through this one table instead of
+	// allocating its own
+	if (config.policy == policyExpectimax) {
+		Ai settings = search;
+		if (!aiInit(&search)) {
+			fprintf(stderr, "could not allocate the search table\n");
+			return 1;
+		}
+		search.depthLimit = settings.depthLimit;
+		search.probCutoff = settings.probCutoff;
+		search.threads = settings.threads;
+	}
+
+	// The network is only read while playing, so every worker shares the
+	// mapped file, as do other processes playing with it
+	NTupleNet net = {{NULL}};
+	if (config.policy == policyNTuple) {
+		boardInit();
+		if (weightsPath == NULL || !ntupleMap(&net, weightsPath)) {
+			fprintf(stderr, "the ntuple policy needs a network file from 2048-train (--weights FILE)\n");
+			ntupleFree(&net);
+			return 1;
+		}
+		config.policyCtx = &net;
+	}
+
+	SimStats stats = {0};
+	double start = timeNow();
+	simRun(&config, &stats);
+	double elapsed = timeNow() - start;
+	ntupleFree(&net);
+	aiFree(&search);
+
+	printStats(stats.games, stats.moves, stats.totalScore, stats.bestScore, stats.maxTile, 16, elapsed);
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+// Self-play trainer for the n-tuple network, running on every core.
+//   2048-train [--games N] [--threads N] [--seed N] [--alpha A] [--report N]
+//              [--checkpoint N] [--eval-games N] [--in FILE] [--out FILE]
+// Game n draws its spawns from stream n of the seed. Every --checkpoint games
+// the network is saved to the output file and scored by greedy play on streams
+// of a different seed, so the figure measures play rather than learning.
+#include "../engine/ntuple.h"
+#include "../engine/platform.h"
+#include "../engine/sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [--games N] [--threads N] [--seed N] [--alpha A] [--report N]\n", prog);
+	fprintf(stderr, "       [--checkpoint N] [--eval-games N] [--in FILE] [--out FILE]\n");
+}
+
+static int64_t minGames(int64_t a, int64_t b) {
+	return a < b ? a : b;
+}
+
+int main(int argc, char **argv) {
+	int64_t games = 100000;
+	int64_t report = 1000;
+	int64_t checkpoint = 10000;
+	int64_t evalGames = 1000;
+	int threads = 0;
+	uint64_t seed = 1;
+	float alpha = NTUPLE_ALPHA;
+	const char *inPath = NULL;
+	const char *outPath = "ntuple.bin";
+
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (value == NULL) {
+			usage(argv[0]);
+			return 1;
+		}
+
+		if (strcmp(arg, "--games") == 0) {
+			games = strtoll(value, NULL, 10);
+		} else if (strcmp(arg, "--threads") == 0) {
+			threads = atoi(value);
+		} else if (strcmp(arg, "--seed") == 0) {
+			seed = strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--alpha") == 0) {
+			alpha = strtof(value, NULL);
+		} else if (strcmp(arg, "--report") == 0) {
+			report = strtoll(value, NULL, 10);
+		} else if (strcmp(arg, "--checkpoint") == 0) {
+			checkpoint = strtoll(value, NULL, 10);
+		} else if (strcmp(arg, "--eval-games") == 0) {
+			evalGames = strtoll(value, NULL, 10);
+		} else if (strcmp(arg, "--in") == 0) {
+			inPath = value;
+		} else if (strcmp(arg, "--out") == 0) {
+			outPath = value;
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+		i++;
+	}
+	if (report < 1) report = 1;
+	if (checkpoint < 1) checkpoint = games;
+
+	boardInit();
+	NTupleNet net;
+	if (!ntupleInit(&net)) {
+		fprintf(stderr, "could not allocate the network\n");
+		return 1;
+	}
+	if (inPath != NULL && !ntupleLoad(&net, inPath)) {
+		fprintf(stderr, "%s is not a network file\n", inPath);
+		ntupleFree(&net);
+		return 1;
+	}
+
+	SimConfig eval = {
+		.games = evalGames,
+		.threads = threads,
+		.seed = ~seed,
+		.policy = policyNTuple,
+		.policyCtx = &net
+	};
+
+	// Workers sync up at every report and checkpoint; rounds are long enough
+	// that the cost of restarting them does not show
+	NTupleTrainStats stats = {0};
+	bool saved = true;
+	double start = timeNow(), lastReport = start;
+	for (int64_t n = 0; n < games;) {
+		int64_t round = minGames(games - n, minGames(report - n % report, checkpoint - n % checkpoint));
+		ntupleTrainParallel(&net, seed, n, round, alpha, threads, &stats);
+		n += round;
+
+		if (n % report == 0 || n == games) {
+			double now = timeNow();
+			printf("games %lld: avg score %.1f, best %lld, 2048 rate %.2f%%, %.0f moves/s\n",
+				(long long)n, (double)stats.totalScore / stats.games, (long long)stats.bestScore,
+				100.0 * stats.reached2048 / stats.games, stats.moves / (now - lastReport));
+			fflush(stdout);
+			stats = (NTupleTrainStats){0};
+			lastReport = now;
+		}
+
+		if (n % checkpoint == 0 || n == games) {
+			saved = ntupleSave(&net, outPath);
+			if (!saved) fprintf(stderr, "error writing %s\n", outPath);
+
+			SimStats evalStats = {0};
+			if (evalGames > 0) simRun(&eval, &evalStats);
+			int64_t reached = 0;
+			for (int e = 11; e < 16; ++e) reached += evalStats.maxTile[e];
+			printf("checkpoint %lld: eval avg score %.1f, 2048 rate %.2f%% over %lld games%s\n",
+				(long long)n, evalStats.games ? (double)evalStats.totalScore / evalStats.games : 0.0,
+				evalStats.games ? 100.0 * reached / evalStats.games : 0.0, (long long)evalStats.games,
+				saved ? "" : " (not saved)");
+			fflush(stdout);
+			lastReport = timeNow();
+		}
+	}
+	printf("trained %lld games in %.3fs\n", (long long)games, timeNow() - start);
+
+	ntupleFree(&net);
+	return saved ? 0 : 1;
+}